@@ -0,0 +1,622 @@
+#include <kspkg-core/include.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined( __linux__ )
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    struct options_t {
+        std::filesystem::path work_dir = std::filesystem::temp_directory_path() / "kspkg-bench";
+        size_t entries = 5000;
+        uint64_t max_file_size = 0x40000;
+        size_t iterations = 5;
+        size_t samples = 200; // Entries timed by the single-entry benchmarks
+        uint64_t seed = 1;
+        bool keep = false;
+    };
+
+    /**
+     * @brief Timings of one benchmark case, reported as one JSON record
+     */
+    struct record_t {
+        std::string name;
+        std::string variant;
+        uint64_t param = 0; // Case parameter, e.g. number of replaced files
+        uint64_t bytes = 0; // Bytes processed by one sample, used for the throughput
+        std::vector< double > samples_ms {};
+    };
+
+    double elapsed_ms( clock_type::time_point since ) {
+        return std::chrono::duration< double, std::milli >( clock_type::now() - since ).count();
+    }
+
+    double time_ms( const std::function< void() >& body ) {
+        const auto started = clock_type::now();
+        body();
+        return elapsed_ms( started );
+    }
+
+    double percentile( std::vector< double > samples, double rank ) {
+        if ( samples.empty() )
+            return 0.0;
+
+        std::sort( samples.begin(), samples.end() );
+        return samples[ static_cast< size_t >( rank * static_cast< double >( samples.size() - 1 ) + 0.5 ) ];
+    }
+
+    /**
+     * @brief Evict a file from the page cache so the next read hits the disk
+     * @return False when the platform offers no way to do it, the "cold" numbers are then warm
+     */
+    bool drop_page_cache( const std::filesystem::path& path ) {
+#if defined( __linux__ )
+        const int fd = ::open( path.c_str(), O_RDONLY );
+        if ( fd < 0 )
+            return false;
+
+        ::fdatasync( fd );
+        const bool dropped = ::posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED ) == 0;
+        ::close( fd );
+        return dropped;
+#else
+        ( void )path;
+        return false;
+#endif
+    }
+
+    std::shared_ptr< kspkg::package > load_or_die( const std::filesystem::path& path, const kspkg::load_options_t& options = {} ) {
+        auto package = kspkg::load_package( path, options );
+        if ( !package ) {
+            std::fprintf( stderr, "error: %s\n", package.error().c_str() );
+            std::exit( 1 );
+        }
+
+        return *package;
+    }
+
+    void generate_or_die( const std::filesystem::path& path, const kspkg::generator_options_t& options ) {
+        if ( const auto result = kspkg::generate_package( path, options ); !result ) {
+            std::fprintf( stderr, "error: %s\n", result.error().c_str() );
+            std::exit( 1 );
+        }
+    }
+
+    void bench_load( const options_t& options, const std::filesystem::path& package_path, std::vector< record_t >& records ) {
+        for ( const bool memory_map : { false, true } ) {
+            record_t record { .name = "load_package", .variant = memory_map ? "mmap" : "stream" };
+
+            for ( size_t i = 0; i < options.iterations; i++ ) {
+                record.samples_ms.push_back( time_ms( [ & ] { load_or_die( package_path, { .memory_map = memory_map } ); } ) );
+            }
+
+            records.push_back( std::move( record ) );
+        }
+
+        // The first load writes the sidecar, the timed ones read it
+        load_or_die( package_path, { .sidecar_index = true } );
+
+        record_t record { .name = "load_package", .variant = "sidecar" };
+        for ( size_t i = 0; i < options.iterations; i++ ) {
+            record.samples_ms.push_back( time_ms( [ & ] { load_or_die( package_path, { .sidecar_index = true } ); } ) );
+        }
+
+        records.push_back( std::move( record ) );
+        std::filesystem::remove( package_path.string() + ".idx" );
+    }
+
+    /**
+     * @return False when a kernel disagrees with the scalar one
+     */
+    bool bench_xor( const options_t& options, std::vector< record_t >& records ) {
+        using kspkg::detail::cipher_isa_t;
+
+        constexpr size_t kBufferSize = 0x4000000; // 64 MB, large enough to leave the caches
+        constexpr std::pair< cipher_isa_t, const char* > kKernels[] = {
+            { cipher_isa_t::kScalar, "scalar" },
+            { cipher_isa_t::kSse2, "sse2" },
+            { cipher_isa_t::kAvx2, "avx2" },
+            { cipher_isa_t::kAvx512, "avx512" },
+        };
+
+        std::vector< uint8_t > reference( 4099 );
+        for ( size_t i = 0; i < reference.size(); i++ ) {
+            reference[ i ] = static_cast< uint8_t >( i * 131 + 7 );
+        }
+
+        // Odd offsets and lengths exercise the unaligned head and the scalar tail of every kernel
+        auto expected = reference;
+        kspkg::detail::encrypt_decrypt_data( std::span( expected ).subspan( 3 ), kspkg::kXorKey, cipher_isa_t::kScalar );
+
+        bool matches = true;
+        std::vector< uint8_t > buffer( kBufferSize, 0x5A );
+
+        for ( const auto& [ isa, name ] : kKernels ) {
+            if ( !kspkg::detail::is_cipher_isa_supported( isa ) )
+                continue;
+
+            auto check = reference;
+            kspkg::detail::encrypt_decrypt_data( std::span( check ).subspan( 3 ), kspkg::kXorKey, isa );
+            if ( check != expected ) {
+                std::fprintf( stderr, "error: %s XOR kernel does not match the scalar one\n", name );
+                matches = false;
+            }
+
+            record_t record { .name = "xor", .variant = name, .bytes = kBufferSize };
+            for ( size_t i = 0; i < options.iterations; i++ ) {
+                record.samples_ms.push_back( time_ms( [ & ] { kspkg::detail::encrypt_decrypt_data( buffer, kspkg::kXorKey, isa ); } ) );
+            }
+
+            records.push_back( std::move( record ) );
+        }
+
+        return matches;
+    }
+
+    void bench_extract_single( const options_t& options, const std::filesystem::path& package_path, std::vector< record_t >& records,
+                               bool& cold_cache ) {
+        for ( const bool memory_map : { false, true } ) {
+            const auto package = load_or_die( package_path, { .memory_map = memory_map } );
+            const auto& files = package->get_files();
+
+            // Spread the samples over the whole package
+            std::vector< kspkg::file > picked;
+            const auto step = std::max< size_t >( files.size() / std::max< size_t >( options.samples, 1 ), 1 );
+            for ( size_t i = 0; i < files.size() && picked.size() < options.samples; i += step ) {
+                picked.push_back( files[ i ] );
+            }
+
+            for ( const bool cold : { true, false } ) {
+                record_t record { .name = "extract_single",
+                                  .variant = std::string( cold ? "cold_" : "warm_" ) + ( memory_map ? "mmap" : "stream" ) };
+
+                // Warm every entry once so the warm samples never touch the disk
+                if ( !cold ) {
+                    for ( const auto file : picked ) {
+                        ( void )package->extract_file( file );
+                    }
+                }
+
+                for ( const auto file : picked ) {
+                    if ( cold )
+                        cold_cache = drop_page_cache( package_path ) && cold_cache;
+
+                    record.samples_ms.push_back( time_ms( [ & ] { ( void )package->extract_file( file ); } ) );
+                    record.bytes += file.get_file_size();
+                }
+
+                record.bytes /= std::max< size_t >( picked.size(), 1 );
+                records.push_back( std::move( record ) );
+            }
+
+            // Warm again, reading into one pooled buffer instead of a fresh vector per entry
+            std::pmr::unsynchronized_pool_resource pool;
+            std::pmr::vector< uint8_t > buffer( &pool );
+            record_t record { .name = "extract_single", .variant = std::string( "warm_into_" ) + ( memory_map ? "mmap" : "stream" ) };
+
+            for ( const auto file : picked ) {
+                record.samples_ms.push_back( time_ms( [ & ] { ( void )package->extract_into( file, buffer ); } ) );
+                record.bytes += file.get_file_size();
+            }
+
+            record.bytes /= std::max< size_t >( picked.size(), 1 );
+            records.push_back( std::move( record ) );
+        }
+    }
+
+    void bench_extract_all( const options_t& options, const std::filesystem::path& package_path, std::vector< record_t >& records ) {
+        const auto package = load_or_die( package_path );
+        const auto out_dir = options.work_dir / "bench-extract";
+
+        uint64_t total_bytes = 0;
+        for ( const auto file : package->get_files() ) {
+            total_bytes += file.get_file_size();
+        }
+
+        for ( const size_t concurrency : { size_t { 1 }, size_t { 0 } } ) {
+            record_t record { .name = "extract_all", .variant = concurrency == 1 ? "serial" : "parallel", .bytes = total_bytes };
+            record.param = concurrency ? concurrency : std::max( std::thread::hardware_concurrency(), 1u );
+
+            for ( size_t i = 0; i < options.iterations; i++ ) {
+                std::filesystem::remove_all( out_dir );
+                record.samples_ms.push_back( time_ms( [ & ] { package->extract_all( out_dir, { .concurrency = concurrency } ); } ) );
+            }
+
+            records.push_back( std::move( record ) );
+        }
+
+        // Same package on one io_uring, skipped where the kernel or the build does not provide it
+        for ( const size_t queue_depth : { size_t { 8 }, size_t { 64 } } ) {
+            const kspkg::extract_options_t extract_options { .backend = kspkg::extract_backend_t::kIoUring, .queue_depth = queue_depth };
+            record_t record { .name = "extract_all", .variant = "io_uring", .param = queue_depth, .bytes = total_bytes };
+
+            bool available = true;
+            for ( size_t i = 0; i < options.iterations && available; i++ ) {
+                std::filesystem::remove_all( out_dir );
+                record.samples_ms.push_back( time_ms( [ & ] {
+                    available = package->extract_all( out_dir, extract_options ).backend == kspkg::extract_backend_t::kIoUring;
+                } ) );
+            }
+
+            if ( available )
+                records.push_back( std::move( record ) );
+        }
+
+        std::filesystem::remove_all( out_dir );
+    }
+
+    void bench_extract_large( const options_t& options, std::vector< record_t >& records ) {
+        constexpr uint64_t kEntrySize = 0x10000000; // 256 MB, well above the pipeline threshold
+
+        const auto package_path = options.work_dir / "large.kspkg";
+        const auto out_dir = options.work_dir / "bench-extract-large";
+        generate_or_die( package_path, { .entry_count = 1,
+                                         .min_file_size = kEntrySize,
+                                         .max_file_size = kEntrySize,
+                                         .encrypted_ratio = 1.0,
+                                         .directory_depth = 0,
+                                         .seed = options.seed } );
+
+        const auto package = load_or_die( package_path );
+        const auto file = package->get_files()[ 0 ];
+        record_t record { .name = "extract_large", .variant = "pipelined", .bytes = file.get_file_size() };
+
+        for ( size_t i = 0; i < options.iterations; i++ ) {
+            std::filesystem::remove_all( out_dir );
+            record.samples_ms.push_back( time_ms( [ & ] { ( void )package->extract_file( file, out_dir ); } ) );
+        }
+
+        records.push_back( std::move( record ) );
+        std::filesystem::remove_all( out_dir );
+        std::filesystem::remove( package_path );
+    }
+
+    void bench_repack( const options_t& options, std::vector< record_t >& records ) {
+        constexpr size_t kReplacedCounts[] = { 1, 10, 100, 1000 };
+
+        // Flat names, so every replaced file resolves against an empty virtual root
+        const kspkg::generator_options_t generator {
+            .entry_count = 1000, .max_file_size = 0x10000, .directory_depth = 0, .seed = options.seed };
+        const auto source_path = options.work_dir / "repack.kspkg";
+        const auto target_path = options.work_dir / "repack-target.kspkg";
+        const auto new_files_dir = options.work_dir / "repack-files";
+        generate_or_die( source_path, generator );
+
+        std::filesystem::create_directories( new_files_dir );
+        std::vector< std::filesystem::path > new_files;
+        const auto source = load_or_die( source_path );
+        for ( const auto file : source->get_files() ) {
+            new_files.push_back( new_files_dir / std::string( file.get_name() ) );
+            std::ofstream( new_files.back(), std::ios::binary ) << std::string( file.get_file_size() % 0x1000 + 1, 'r' );
+        }
+
+        for ( const auto count : kReplacedCounts ) {
+            const auto replaced_count = static_cast< std::ptrdiff_t >( std::min( count, new_files.size() ) );
+            const std::vector< std::filesystem::path > replaced( new_files.begin(), new_files.begin() + replaced_count );
+            record_t record { .name = "repack_package", .variant = "append", .param = replaced.size() };
+
+            for ( size_t i = 0; i < options.iterations; i++ ) {
+                std::filesystem::copy_file( source_path, target_path, std::filesystem::copy_options::overwrite_existing );
+                const auto package = load_or_die( target_path );
+
+                record.samples_ms.push_back( time_ms( [ & ] { ( void )kspkg::repack_package( package, replaced, "" ); } ) );
+            }
+
+            records.push_back( std::move( record ) );
+
+            // The empty metadata slots cloned from one written stretch, the same as `append` where reflinks are not supported
+            record_t shared { .name = "repack_package", .variant = "append_shared_metadata", .param = replaced.size() };
+            for ( size_t i = 0; i < options.iterations; i++ ) {
+                std::filesystem::copy_file( source_path, target_path, std::filesystem::copy_options::overwrite_existing );
+                const auto package = load_or_die( target_path );
+
+                shared.samples_ms.push_back(
+                    time_ms( [ & ] { ( void )kspkg::repack_package( package, replaced, "", { .share_metadata_tail = true } ); } ) );
+            }
+
+            records.push_back( std::move( shared ) );
+
+            // The same files applied again, they fit the data of the first patch and are overwritten in place
+            record_t in_place { .name = "repack_package", .variant = "in_place", .param = replaced.size() };
+            for ( size_t i = 0; i < options.iterations; i++ ) {
+                std::filesystem::copy_file( source_path, target_path, std::filesystem::copy_options::overwrite_existing );
+                const auto package = load_or_die( target_path );
+                ( void )kspkg::repack_package( package, replaced, "" );
+
+                in_place.samples_ms.push_back( time_ms( [ & ] { ( void )kspkg::repack_package( package, replaced, "" ); } ) );
+            }
+
+            records.push_back( std::move( in_place ) );
+
+            // The same files applied one call each, every call writes its own metadata block
+            if ( replaced.size() > 10 )
+                continue;
+
+            record_t separate { .name = "repack_package", .variant = "separate", .param = replaced.size() };
+            for ( size_t i = 0; i < options.iterations; i++ ) {
+                std::filesystem::copy_file( source_path, target_path, std::filesystem::copy_options::overwrite_existing );
+                const auto package = load_or_die( target_path );
+
+                separate.samples_ms.push_back( time_ms( [ & ] {
+                    for ( const auto& file : replaced ) {
+                        ( void )kspkg::repack_package( package, { file }, "" );
+                    }
+                } ) );
+            }
+
+            records.push_back( std::move( separate ) );
+        }
+
+        std::filesystem::remove( source_path );
+        std::filesystem::remove( target_path );
+        std::filesystem::remove_all( new_files_dir );
+    }
+
+    void bench_remove_patches( const options_t& options, std::vector< record_t >& records ) {
+        constexpr uint64_t kPatchSizes[] = { 0x100000, 0x1000000, 0x4000000 }; // 1, 16 and 64 MB of new data
+
+        const kspkg::generator_options_t generator {
+            .entry_count = 100, .max_file_size = 0x10000, .directory_depth = 0, .seed = options.seed };
+        const auto source_path = options.work_dir / "unpatch.kspkg";
+        const auto target_path = options.work_dir / "unpatch-target.kspkg";
+        generate_or_die( source_path, generator );
+
+        const auto entry_name = std::string( load_or_die( source_path )->get_files()[ 0 ].get_name() );
+        const auto patch_file = options.work_dir / entry_name;
+
+        for ( const auto patch_size : kPatchSizes ) {
+            std::ofstream( patch_file, std::ios::binary ) << std::string( patch_size, 'p' );
+            record_t record { .name = "remove_patches", .variant = "truncate", .param = patch_size };
+
+            for ( size_t i = 0; i < options.iterations; i++ ) {
+                std::filesystem::copy_file( source_path, target_path, std::filesystem::copy_options::overwrite_existing );
+                ( void )kspkg::repack_package( load_or_die( target_path ), { patch_file }, "" );
+                const auto package = load_or_die( target_path );
+
+                record.samples_ms.push_back( time_ms( [ & ] { ( void )kspkg::remove_patches( package ); } ) );
+            }
+
+            records.push_back( std::move( record ) );
+        }
+
+        std::filesystem::remove( source_path );
+        std::filesystem::remove( target_path );
+        std::filesystem::remove( patch_file );
+    }
+
+    void bench_compact( const options_t& options, std::vector< record_t >& records ) {
+        constexpr size_t kGenerations = 8;
+        constexpr size_t kFilesPerGeneration = 50;
+
+        const kspkg::generator_options_t generator {
+            .entry_count = 1000, .max_file_size = 0x40000, .directory_depth = 0, .seed = options.seed };
+        const auto source_path = options.work_dir / "compact.kspkg";
+        const auto target_path = options.work_dir / "compact-target.kspkg";
+        const auto new_files_dir = options.work_dir / "compact-files";
+        generate_or_die( source_path, generator );
+
+        // Every generation replaces a different slice of the entries and leaves an old metadata block behind
+        std::filesystem::create_directories( new_files_dir );
+        {
+            const auto package = load_or_die( source_path );
+            const auto& files = package->get_files();
+
+            for ( size_t generation = 0; generation < kGenerations; generation++ ) {
+                std::vector< std::filesystem::path > replaced;
+                for ( size_t i = 0; i < kFilesPerGeneration; i++ ) {
+                    const auto file = files[ ( generation * kFilesPerGeneration + i ) % files.size() ];
+                    replaced.push_back( new_files_dir / std::string( file.get_name() ) );
+                    std::ofstream( replaced.back(), std::ios::binary ) << std::string( file.get_file_size() + 1, 'c' );
+                }
+
+                ( void )kspkg::repack_package( package, replaced, "" );
+            }
+        }
+
+        record_t record { .name = "compact_package", .variant = "live_runs", .param = kGenerations };
+        for ( size_t i = 0; i < options.iterations; i++ ) {
+            std::filesystem::copy_file( source_path, target_path, std::filesystem::copy_options::overwrite_existing );
+            const auto package = load_or_die( target_path );
+
+            record.samples_ms.push_back( time_ms( [ & ] {
+                if ( const auto report = kspkg::compact_package( package ) )
+                    record.bytes = report->new_size;
+            } ) );
+        }
+
+        records.push_back( std::move( record ) );
+
+        std::filesystem::remove( source_path );
+        std::filesystem::remove( target_path );
+        std::filesystem::remove_all( new_files_dir );
+    }
+
+    void bench_locality( const options_t& options, const std::filesystem::path& package_path, std::vector< record_t >& records,
+                         bool& cold_cache ) {
+        const auto rebuilt_path = options.work_dir / "locality.kspkg";
+        const auto out_dir = options.work_dir / "bench-locality";
+
+        std::filesystem::copy_file( package_path, rebuilt_path, std::filesystem::copy_options::overwrite_existing );
+        if ( const auto report = kspkg::compact_package( load_or_die( rebuilt_path ), { .layout = kspkg::compact_layout_t::kByPath } ); !report ) {
+            std::fprintf( stderr, "error: %s\n", report.error().c_str() );
+            std::exit( 1 );
+        }
+
+        // One top-level directory, the way the tools read `uiresources\localization\`
+        std::string subtree;
+        const auto original = load_or_die( package_path );
+        for ( const auto file : original->get_files() ) {
+            if ( const auto separator = file.get_name().find( '\\' ); separator != std::string_view::npos ) {
+                subtree = std::string( file.get_name().substr( 0, separator + 1 ) );
+                break;
+            }
+        }
+
+        for ( const auto& [ variant, path ] : { std::pair( "package_order", package_path ), std::pair( "path_order", rebuilt_path ) } ) {
+            const auto package = load_or_die( path );
+
+            std::vector< kspkg::file > picked;
+            uint64_t bytes = 0;
+            for ( const auto file : package->get_files() ) {
+                if ( file.get_name().starts_with( subtree ) ) {
+                    picked.push_back( file );
+                    bytes += file.get_file_size();
+                }
+            }
+
+            record_t record { .name = "extract_subtree", .variant = variant, .param = picked.size(), .bytes = bytes };
+            for ( size_t i = 0; i < options.iterations; i++ ) {
+                std::filesystem::remove_all( out_dir );
+                cold_cache = drop_page_cache( path ) && cold_cache;
+
+                record.samples_ms.push_back( time_ms( [ & ] { package->extract_many( picked, out_dir ); } ) );
+            }
+
+            records.push_back( std::move( record ) );
+
+            // Reads alone, in subtree order into one buffer, without creating the output files
+            std::vector< uint8_t > buffer;
+            record_t read_record { .name = "read_subtree", .variant = variant, .param = picked.size(), .bytes = bytes };
+            for ( size_t i = 0; i < options.iterations; i++ ) {
+                cold_cache = drop_page_cache( path ) && cold_cache;
+
+                read_record.samples_ms.push_back( time_ms( [ & ] {
+                    for ( const auto file : picked ) {
+                        buffer.resize( file.get_file_size() );
+                        ( void )package->extract_into( file, buffer );
+                    }
+                } ) );
+            }
+
+            records.push_back( std::move( read_record ) );
+        }
+
+        std::filesystem::remove( rebuilt_path );
+        std::filesystem::remove_all( out_dir );
+    }
+
+    void print_json( const options_t& options, uint64_t package_bytes, bool cold_cache, const std::vector< record_t >& records ) {
+        std::printf( "{\n  \"config\": {\"entries\": %zu, \"max_file_size\": %llu, \"iterations\": %zu, \"samples\": %zu, \"seed\": %llu, "
+                     "\"package_bytes\": %llu, \"hardware_threads\": %u, \"cold_cache\": %s},\n  \"results\": [\n",
+                     options.entries, static_cast< unsigned long long >( options.max_file_size ), options.iterations, options.samples,
+                     static_cast< unsigned long long >( options.seed ), static_cast< unsigned long long >( package_bytes ),
+                     std::thread::hardware_concurrency(), cold_cache ? "true" : "false" );
+
+        for ( size_t i = 0; i < records.size(); i++ ) {
+            const auto& record = records[ i ];
+            const double median_ms = percentile( record.samples_ms, 0.5 );
+            const double megabytes = static_cast< double >( record.bytes ) / ( 1024.0 * 1024.0 );
+            const double mb_per_s = median_ms > 0.0 ? megabytes / ( median_ms / 1000.0 ) : 0.0;
+
+            std::printf( "    {\"name\": \"%s\", \"variant\": \"%s\", \"param\": %llu, \"bytes\": %llu, \"samples\": %zu, "
+                         "\"min_ms\": %.4f, "
+                         "\"median_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, \"mb_per_s\": %.2f}%s\n",
+                         record.name.c_str(), record.variant.c_str(), static_cast< unsigned long long >( record.param ),
+                         static_cast< unsigned long long >( record.bytes ), record.samples_ms.size(), percentile( record.samples_ms, 0.0 ),
+                         median_ms, percentile( record.samples_ms, 0.99 ), percentile( record.samples_ms, 1.0 ), mb_per_s,
+                         i + 1 < records.size() ? "," : "" );
+        }
+
+        std::printf( "  ]\n}\n" );
+    }
+
+    void print_usage() {
+        std::fprintf( stderr, "usage: kspkg-bench [--key=value...] [--keep]\n"
+                              "\n"
+                              "options:\n"
+                              "  --work-dir=PATH    Directory for generated packages, defaults to a temporary one\n"
+                              "  --entries=N        Entries in the main generated package (5000)\n"
+                              "  --max-size=BYTES   Largest generated entry (262144)\n"
+                              "  --iterations=N     Repetitions of every case (5)\n"
+                              "  --samples=N        Entries timed by the single-entry cases (200)\n"
+                              "  --seed=N           Generator seed (1)\n"
+                              "  --keep             Keep the generated main package\n"
+                              "\n"
+                              "Results are written to stdout as JSON, one record per case.\n" );
+    }
+
+} // namespace
+
+int main( int argc, char** argv ) {
+    options_t options;
+
+    for ( int i = 1; i < argc; i++ ) {
+        const std::string_view arg = argv[ i ];
+        const auto separator = arg.find( '=' );
+
+        if ( arg == "--keep" ) {
+            options.keep = true;
+            continue;
+        }
+
+        if ( !arg.starts_with( "--" ) || separator == std::string_view::npos ) {
+            print_usage();
+            return 2;
+        }
+
+        const auto key = arg.substr( 2, separator - 2 );
+        const std::string value( arg.substr( separator + 1 ) );
+
+        if ( key == "work-dir" )
+            options.work_dir = value;
+        else if ( key == "entries" )
+            options.entries = std::strtoull( value.c_str(), nullptr, 10 );
+        else if ( key == "max-size" )
+            options.max_file_size = std::strtoull( value.c_str(), nullptr, 10 );
+        else if ( key == "iterations" )
+            options.iterations = std::max< size_t >( std::strtoull( value.c_str(), nullptr, 10 ), 1 );
+        else if ( key == "samples" )
+            options.samples = std::strtoull( value.c_str(), nullptr, 10 );
+        else if ( key == "seed" )
+            options.seed = std::strtoull( value.c_str(), nullptr, 10 );
+        else {
+            print_usage();
+            return 2;
+        }
+    }
+
+    std::filesystem::create_directories( options.work_dir );
+
+    const auto package_path = options.work_dir / "bench.kspkg";
+    generate_or_die( package_path, { .entry_count = options.entries, .max_file_size = options.max_file_size, .seed = options.seed } );
+
+    std::vector< record_t > records;
+    bool cold_cache = true;
+
+    bench_load( options, package_path, records );
+    const bool xor_matches = bench_xor( options, records );
+    bench_extract_single( options, package_path, records, cold_cache );
+    bench_extract_all( options, package_path, records );
+    bench_locality( options, package_path, records, cold_cache );
+    bench_extract_large( options, records );
+    bench_repack( options, records );
+    bench_remove_patches( options, records );
+    bench_compact( options, records );
+
+    print_json( options, std::filesystem::file_size( package_path ), cold_cache, records );
+
+    if ( !options.keep ) {
+        // Only remove what was created here, the work directory itself goes away if it ends up empty
+        std::error_code ec;
+        std::filesystem::remove( package_path, ec );
+        std::filesystem::remove( options.work_dir, ec );
+    }
+
+    return xor_matches ? 0 : 1;
+}
\ No newline at end of file
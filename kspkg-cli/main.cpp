@@ -0,0 +1,507 @@
+#include <kspkg-core/include.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+    #include <fcntl.h>
+    #include <io.h>
+#endif
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    struct options_t {
+        bool timing = false;
+        bool memory_map = false;
+        bool sidecar_index = false;
+        bool io_uring = false;
+        bool share_metadata = false;
+        size_t concurrency = 0;
+        std::vector< std::string > args;
+    };
+
+    /**
+     * @brief Numbers collected by a command for the `--timing` report
+     */
+    struct timing_t {
+        double load_ms = 0.0;
+        double run_ms = 0.0;
+        uint64_t files = 0;
+        uint64_t bytes = 0;
+    };
+
+    using command_t = std::function< int( const options_t& options, timing_t& timing ) >;
+
+    double elapsed_ms( clock_type::time_point since ) {
+        return std::chrono::duration< double, std::milli >( clock_type::now() - since ).count();
+    }
+
+    int fail( const std::string& message ) {
+        std::fprintf( stderr, "error: %s\n", message.c_str() );
+        return 1;
+    }
+
+    /**
+     * @brief Match a package path against a glob pattern
+     *
+     * `*` and `?` stay inside one path component, `**` also crosses `/`. Both `/` and `\` act as separators.
+     */
+    bool glob_match( std::string_view pattern, std::string_view path ) {
+        const auto is_separator = []( char c ) { return c == '/' || c == '\\'; };
+
+        size_t p = 0, s = 0;
+        size_t star_p = std::string_view::npos, star_s = 0;
+        bool star_crosses = false;
+
+        while ( s < path.size() ) {
+            if ( p + 1 < pattern.size() && pattern[ p ] == '*' && pattern[ p + 1 ] == '*' ) {
+                star_p = p += 2;
+                star_s = s;
+                star_crosses = true;
+            }
+            else if ( p < pattern.size() && pattern[ p ] == '*' ) {
+                star_p = ++p;
+                star_s = s;
+                star_crosses = false;
+            }
+            else if ( p < pattern.size() &&
+                      ( pattern[ p ] == path[ s ] || ( pattern[ p ] == '?' && !is_separator( path[ s ] ) ) ||
+                        ( is_separator( pattern[ p ] ) && is_separator( path[ s ] ) ) ) ) {
+                p++;
+                s++;
+            }
+            else if ( star_p != std::string_view::npos && ( star_crosses || !is_separator( path[ star_s ] ) ) ) {
+                // Let the last star swallow one more character and retry
+                p = star_p;
+                s = ++star_s;
+            }
+            else {
+                return false;
+            }
+        }
+
+        while ( p < pattern.size() && pattern[ p ] == '*' ) {
+            p++;
+        }
+
+        return p == pattern.size();
+    }
+
+    bool matches_any( const std::vector< std::string >& patterns, std::string_view path ) {
+        if ( patterns.empty() )
+            return true;
+
+        for ( const auto& pattern : patterns ) {
+            if ( glob_match( pattern, path ) )
+                return true;
+        }
+
+        return false;
+    }
+
+    kspkg::expected< std::shared_ptr< kspkg::package > > open_package( const options_t& options, timing_t& timing ) {
+        const auto started = clock_type::now();
+        auto package = kspkg::load_package( options.args.at( 0 ), {
+            .memory_map = options.memory_map, .concurrency = options.concurrency, .sidecar_index = options.sidecar_index } );
+        timing.load_ms = elapsed_ms( started );
+
+        return package;
+    }
+
+    int command_list( const options_t& options, timing_t& timing ) {
+        const auto package = open_package( options, timing );
+        if ( !package )
+            return fail( package.error() );
+
+        const std::vector< std::string > patterns( options.args.begin() + 1, options.args.end() );
+
+        const auto started = clock_type::now();
+        for ( const auto file : ( *package )->get_files() ) {
+            if ( !matches_any( patterns, file.get_name() ) )
+                continue;
+
+            std::printf( "%llu\t%llu\t%c%c\t%.*s\n", static_cast< unsigned long long >( file.get_file_offset() ),
+                         static_cast< unsigned long long >( file.get_file_size() ), file.is_directory() ? 'd' : '-',
+                         file.is_encrypted() ? 'e' : '-', static_cast< int >( file.get_name().size() ), file.get_name().data() );
+
+            timing.files += 1;
+            timing.bytes += file.get_file_size();
+        }
+        timing.run_ms = elapsed_ms( started );
+
+        return 0;
+    }
+
+    int command_cat( const options_t& options, timing_t& timing ) {
+        if ( options.args.size() != 2 )
+            return fail( "usage: cat <package> <path>" );
+
+        const auto package = open_package( options, timing );
+        if ( !package )
+            return fail( package.error() );
+
+        const auto file = ( *package )->find( options.args[ 1 ] );
+        if ( !file )
+            return fail( "File not found in the package: " + options.args[ 1 ] );
+
+#ifdef _WIN32
+        _setmode( _fileno( stdout ), _O_BINARY );
+#endif
+        std::fflush( stdout );
+
+        const auto started = clock_type::now();
+        if ( const auto result = ( *package )->extract_to( file, 1 ); !result )
+            return fail( result.error() );
+        timing.run_ms = elapsed_ms( started );
+
+        timing.files = 1;
+        timing.bytes = file.get_file_size();
+
+        return 0;
+    }
+
+    int command_extract( const options_t& options, timing_t& timing ) {
+        if ( options.args.size() < 2 )
+            return fail( "usage: extract <package> <out_directory> [glob...]" );
+
+        const auto package = open_package( options, timing );
+        if ( !package )
+            return fail( package.error() );
+
+        const std::vector< std::string > patterns( options.args.begin() + 2, options.args.end() );
+
+        std::vector< kspkg::file > files;
+        for ( const auto file : ( *package )->get_files() ) {
+            if ( !file.is_directory() && matches_any( patterns, file.get_name() ) )
+                files.push_back( file );
+        }
+
+        const auto started = clock_type::now();
+        const kspkg::extract_options_t extract_options {
+            .concurrency = options.concurrency,
+            .backend = options.io_uring ? kspkg::extract_backend_t::kIoUring : kspkg::extract_backend_t::kThreads,
+        };
+
+        const auto report = ( *package )->extract_many( files, options.args[ 1 ], extract_options );
+        timing.run_ms = elapsed_ms( started );
+
+        for ( const auto& result : report.results ) {
+            if ( !result.status ) {
+                const auto name = result.entry.get_name();
+                std::fprintf( stderr, "error: %.*s: %s\n", static_cast< int >( name.size() ), name.data(), result.status.error().c_str() );
+            }
+        }
+
+        timing.files = report.extracted;
+        timing.bytes = report.bytes;
+
+        std::printf( "Extracted %zu file(s), failed to extract %zu file(s)\n", report.extracted, report.failed );
+        return report.failed == 0 ? 0 : 1;
+    }
+
+    int command_patch( const options_t& options, timing_t& timing ) {
+        if ( options.args.size() < 3 )
+            return fail( "usage: patch <package> <virtual_root> <file>... [-- <virtual_root> <file>...]" );
+
+        const auto package = open_package( options, timing );
+        if ( !package )
+            return fail( package.error() );
+
+        // Every `--` starts another virtual root, all of them go into one patch
+        kspkg::patch_builder builder( *package );
+
+        for ( size_t begin = 1; begin < options.args.size(); ) {
+            const auto end = std::find( options.args.begin() + static_cast< std::ptrdiff_t >( begin ), options.args.end(), "--" );
+            const auto root_position = options.args.begin() + static_cast< std::ptrdiff_t >( begin );
+
+            if ( root_position != end ) {
+                const std::vector< std::filesystem::path > root_files( root_position + 1, end );
+                builder.stage( root_files, *root_position );
+            }
+
+            begin = static_cast< size_t >( end - options.args.begin() ) + 1;
+        }
+
+        // Count what was actually staged, paths matching no entry are skipped and `commit` empties the builder
+        const size_t staged_files = builder.staged_count();
+        const uint64_t staged_bytes = builder.staged_bytes();
+
+        const auto started = clock_type::now();
+        if ( const auto result = builder.commit( { .share_metadata_tail = options.share_metadata } ); !result )
+            return fail( result.error() );
+        timing.run_ms = elapsed_ms( started );
+
+        timing.files = staged_files;
+        timing.bytes = staged_bytes;
+
+        return 0;
+    }
+
+    int command_unpatch( const options_t& options, timing_t& timing ) {
+        if ( options.args.size() != 1 )
+            return fail( "usage: unpatch <package>" );
+
+        const auto package = open_package( options, timing );
+        if ( !package )
+            return fail( package.error() );
+
+        const auto started = clock_type::now();
+        const auto result = kspkg::remove_patches( *package );
+        if ( !result )
+            return fail( result.error() );
+        timing.run_ms = elapsed_ms( started );
+
+        std::printf( "%s\n", *result ? "Patches removed." : "No patches found." );
+        return 0;
+    }
+
+    int command_patches( const options_t& options, timing_t& timing ) {
+        if ( options.args.size() != 1 )
+            return fail( "usage: patches <package>" );
+
+        const auto package = open_package( options, timing );
+        if ( !package )
+            return fail( package.error() );
+
+        const auto started = clock_type::now();
+        const auto generations = kspkg::list_patches( *package );
+        if ( !generations )
+            return fail( generations.error() );
+        timing.run_ms = elapsed_ms( started );
+
+        for ( size_t i = 0; i < generations->size(); i++ ) {
+            const auto& generation = ( *generations )[ i ];
+
+            char created[ 32 ] = "-";
+            const auto created_time = static_cast< std::time_t >( generation.created );
+            if ( generation.created != 0 ) {
+                if ( const auto* utc = std::gmtime( &created_time ) )
+                    std::strftime( created, sizeof( created ), "%Y-%m-%dT%H:%M:%SZ", utc );
+            }
+
+            std::printf( "%zu\t%llu\t%llu\t%s\t%zu\n", i, static_cast< unsigned long long >( generation.offset ),
+                         static_cast< unsigned long long >( generation.size ), created, generation.touched.size() );
+
+            for ( const auto& name : generation.touched ) {
+                std::printf( "\t%s\n", name.c_str() );
+            }
+
+            timing.files += generation.touched.size();
+        }
+
+        return 0;
+    }
+
+    int command_rollback( const options_t& options, timing_t& timing ) {
+        if ( options.args.size() != 2 )
+            return fail( "usage: rollback <package> <generation>" );
+
+        // A typo must not read as generation 0, that would drop every patch
+        const auto& argument = options.args[ 1 ];
+        size_t generation = 0;
+        if ( const auto [ end, ec ] = std::from_chars( argument.data(), argument.data() + argument.size(), generation );
+             ec != std::errc() || end != argument.data() + argument.size() )
+            return fail( "invalid generation: " + argument );
+
+        const auto package = open_package( options, timing );
+        if ( !package )
+            return fail( package.error() );
+
+        // Generations that `list_patches` does not report are refused there
+        const auto started = clock_type::now();
+        if ( const auto result = kspkg::roll_back_patches( *package, generation ); !result )
+            return fail( result.error() );
+        timing.run_ms = elapsed_ms( started );
+
+        return 0;
+    }
+
+    int rewrite_package( const options_t& options, timing_t& timing, kspkg::compact_layout_t layout ) {
+        const auto package = open_package( options, timing );
+        if ( !package )
+            return fail( package.error() );
+
+        const auto started = clock_type::now();
+        const auto report = kspkg::compact_package( *package, { .layout = layout, .share_metadata_tail = options.share_metadata } );
+        if ( !report )
+            return fail( report.error() );
+        timing.run_ms = elapsed_ms( started );
+
+        timing.files = ( *package )->get_files().size();
+        timing.bytes = report->new_size;
+
+        std::printf( "Reclaimed %llu byte(s), %llu -> %llu, %zu run(s) copied\n", static_cast< unsigned long long >( report->reclaimed ),
+                     static_cast< unsigned long long >( report->old_size ), static_cast< unsigned long long >( report->new_size ), report->runs );
+        return 0;
+    }
+
+    int command_compact( const options_t& options, timing_t& timing ) {
+        if ( options.args.size() != 1 )
+            return fail( "usage: compact <package>" );
+
+        return rewrite_package( options, timing, kspkg::compact_layout_t::kPackageOrder );
+    }
+
+    int command_rebuild( const options_t& options, timing_t& timing ) {
+        if ( options.args.size() != 1 )
+            return fail( "usage: rebuild <package>" );
+
+        return rewrite_package( options, timing, kspkg::compact_layout_t::kByPath );
+    }
+
+    int command_generate( const options_t& options, timing_t& timing ) {
+        kspkg::generator_options_t generator;
+
+        for ( size_t i = 1; i < options.args.size(); i++ ) {
+            const std::string_view arg = options.args[ i ];
+            const auto separator = arg.find( '=' );
+            if ( !arg.starts_with( "--" ) || separator == std::string_view::npos )
+                return fail( "Expected --key=value, got: " + options.args[ i ] );
+
+            const auto key = arg.substr( 2, separator - 2 );
+            const std::string value( arg.substr( separator + 1 ) );
+
+            if ( key == "entries" )
+                generator.entry_count = std::strtoull( value.c_str(), nullptr, 10 );
+            else if ( key == "min-size" )
+                generator.min_file_size = std::strtoull( value.c_str(), nullptr, 10 );
+            else if ( key == "max-size" )
+                generator.max_file_size = std::strtoull( value.c_str(), nullptr, 10 );
+            else if ( key == "distribution" && ( value == "uniform" || value == "log" ) )
+                generator.size_distribution = value == "uniform" ? kspkg::size_distribution_t::kUniform
+                                                                 : kspkg::size_distribution_t::kLogUniform;
+            else if ( key == "encrypted" )
+                generator.encrypted_ratio = std::strtod( value.c_str(), nullptr );
+            else if ( key == "depth" )
+                generator.directory_depth = std::strtoull( value.c_str(), nullptr, 10 );
+            else if ( key == "fanout" )
+                generator.directory_fanout = std::strtoull( value.c_str(), nullptr, 10 );
+            else if ( key == "seed" )
+                generator.seed = std::strtoull( value.c_str(), nullptr, 10 );
+            else
+                return fail( "Unknown generator option: " + options.args[ i ] );
+        }
+
+        const auto started = clock_type::now();
+        const auto entries = kspkg::generate_package( options.args[ 0 ], generator );
+        if ( !entries )
+            return fail( entries.error() );
+        timing.run_ms = elapsed_ms( started );
+
+        timing.files = entries->size();
+        for ( const auto& entry : *entries ) {
+            timing.bytes += entry.file_size;
+        }
+
+        std::printf( "Generated %zu entries, %llu data bytes\n", entries->size(), static_cast< unsigned long long >( timing.bytes ) );
+        return 0;
+    }
+
+    void print_usage() {
+        std::fprintf( stderr, "usage: kspkg-cli [--timing] [--mmap] [--index] [--io-uring] [-j N] <command> <package> [args...]\n"
+                              "\n"
+                              "commands:\n"
+                              "  list <package> [glob...]                   List entries as offset, size, flags and name\n"
+                              "  cat <package> <path>                       Write one entry to stdout\n"
+                              "  extract <package> <out_directory> [glob...] Extract matching entries\n"
+                              "  patch <package> <virtual_root> <file>...   Replace entries under the virtual root, `--` starts\n"
+                              "                                             another root, all roots are applied as one patch\n"
+                              "  unpatch <package>                          Remove the last patch\n"
+                              "  patches <package>                          List generations as index, offset, size, creation time\n"
+                              "                                             and number of touched entries, followed by their names\n"
+                              "  rollback <package> <generation>            Remove every patch above the generation, 0 is the base\n"
+                              "  compact <package>                          Rewrite the package with only live data, drops all patches\n"
+                              "  rebuild <package>                          Like compact, with the entries grouped by directory and sorted by path\n"
+                              "  generate <package> [--key=value...]        Write a synthetic package, keys: entries, min-size,\n"
+                              "                                             max-size, distribution (uniform|log), encrypted, depth,\n"
+                              "                                             fanout, seed\n"
+                              "\n"
+                              "options:\n"
+                              "  --timing          Print a JSON timing report to stderr\n"
+                              "  --mmap            Map the package instead of using positional reads\n"
+                              "  --index           Open through the `<package>.idx` sidecar, creating or refreshing it as needed\n"
+                              "  --io-uring        Extract through io_uring on Linux, falls back to worker threads when unavailable\n"
+                              "  --share-metadata  Store the empty slots of new metadata blocks as shared extents where the file\n"
+                              "                    system supports reflinks, for patch, compact and rebuild\n"
+                              "  -j N              Worker threads for loading and extraction, 0 means one per hardware thread\n"
+                              "\n"
+                              "globs: `*` and `?` stay inside one path component, `**` crosses directories\n" );
+    }
+
+} // namespace
+
+int main( int argc, char** argv ) {
+    const std::map< std::string_view, command_t > commands = {
+        { "list", command_list },         { "cat", command_cat },         { "extract", command_extract },
+        { "patch", command_patch },       { "unpatch", command_unpatch }, { "patches", command_patches },
+        { "rollback", command_rollback }, { "compact", command_compact }, { "rebuild", command_rebuild },
+        { "generate", command_generate },
+    };
+
+    options_t options;
+    std::string_view command_name;
+
+    for ( int i = 1; i < argc; i++ ) {
+        const std::string_view arg = argv[ i ];
+
+        if ( command_name.empty() && arg == "--timing" ) {
+            options.timing = true;
+        }
+        else if ( command_name.empty() && arg == "--mmap" ) {
+            options.memory_map = true;
+        }
+        else if ( command_name.empty() && arg == "--index" ) {
+            options.sidecar_index = true;
+        }
+        else if ( command_name.empty() && arg == "--io-uring" ) {
+            options.io_uring = true;
+        }
+        else if ( command_name.empty() && arg == "--share-metadata" ) {
+            options.share_metadata = true;
+        }
+        else if ( command_name.empty() && arg == "-j" && i + 1 < argc ) {
+            options.concurrency = std::strtoull( argv[ ++i ], nullptr, 10 );
+        }
+        else if ( command_name.empty() ) {
+            command_name = arg;
+        }
+        else {
+            options.args.emplace_back( arg );
+        }
+    }
+
+    const auto command = commands.find( command_name );
+    if ( command == commands.end() || options.args.empty() ) {
+        print_usage();
+        return 2;
+    }
+
+    timing_t timing;
+    const auto started = clock_type::now();
+    const int exit_code = command->second( options, timing );
+    const double total_ms = elapsed_ms( started );
+
+    if ( options.timing ) {
+        const double megabytes = static_cast< double >( timing.bytes ) / ( 1024.0 * 1024.0 );
+        const double mb_per_s = timing.run_ms > 0.0 ? megabytes / ( timing.run_ms / 1000.0 ) : 0.0;
+
+        std::fprintf( stderr,
+                      "{\"command\":\"%.*s\",\"exit_code\":%d,\"load_ms\":%.3f,\"run_ms\":%.3f,\"total_ms\":%.3f,"
+                      "\"files\":%llu,\"bytes\":%llu,\"mb_per_s\":%.3f}\n",
+                      static_cast< int >( command_name.size() ), command_name.data(), exit_code, timing.load_ms, timing.run_ms, total_ms,
+                      static_cast< unsigned long long >( timing.files ), static_cast< unsigned long long >( timing.bytes ), mb_per_s );
+    }
+
+    return exit_code;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace kspkg {
+    constexpr size_t kXorKey = 0x9F9721A97D1135C1;
+
+    namespace detail {
+
+        enum class cipher_isa_t {
+            kScalar,
+            kSse2,
+            kAvx2,
+            kAvx512,
+        };
+
+        /**
+         * @brief Key phase for data that starts `offset` bytes into an encrypted stream
+         */
+        [[nodiscard]] constexpr size_t key_at_offset( size_t key, uint64_t offset ) noexcept {
+            return std::rotr( key, static_cast< int >( offset % sizeof( size_t ) ) * 8 );
+        }
+
+        /**
+         * @brief Check whether the CPU and the build support the given XOR kernel
+         */
+        [[nodiscard]] bool is_cipher_isa_supported( cipher_isa_t isa ) noexcept;
+
+        /**
+         * @brief Widest XOR kernel supported by the running CPU
+         */
+        [[nodiscard]] cipher_isa_t best_cipher_isa() noexcept;
+
+        /**
+         * @brief XOR the data with the repeating 8-byte key, using the best kernel for the running CPU
+         * @param data Data to encrypt or decrypt in place
+         * @param key Key, its low byte is applied to `data[ 0 ]`
+         */
+        void encrypt_decrypt_data( std::span< uint8_t > data, size_t key ) noexcept;
+
+        /**
+         * @brief XOR the data with the repeating 8-byte key, using the given kernel
+         * @note The kernel must be supported, see `is_cipher_isa_supported`
+         */
+        void encrypt_decrypt_data( std::span< uint8_t > data, size_t key, cipher_isa_t isa ) noexcept;
+
+    } // namespace detail
+} // namespace kspkg
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace kspkg {
+
+    using shared_content_t = std::shared_ptr< const std::vector< uint8_t > >;
+
+    struct content_cache_stats_t {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t budget = 0;
+    };
+
+    /**
+     * @brief Thread-safe LRU cache of decrypted entry contents, bounded by a byte budget
+     *
+     * Buffers are shared and immutable, an evicted buffer stays alive for as long as a reader holds it.
+     */
+    class content_cache {
+    public:
+        explicit content_cache( size_t budget = 0 ) : budget_( budget ) { }
+
+        content_cache( const content_cache& ) = delete;
+        content_cache& operator=( const content_cache& ) = delete;
+
+        /**
+         * @brief Look an entry up and mark it as the most recently used, counts a hit or a miss
+         * @return Cached contents, or null
+         */
+        [[nodiscard]] shared_content_t find( uint32_t key );
+
+        /**
+         * @brief Insert contents and evict the least recently used entries until the budget holds
+         * @note Contents larger than the whole budget are not cached
+         * @return The cached buffer, which is an earlier one when another reader inserted the key first
+         */
+        shared_content_t insert( uint32_t key, shared_content_t content );
+
+        /**
+         * @brief Drop one entry, e.g. after its data moved
+         */
+        void erase( uint32_t key );
+
+        void clear();
+
+        /**
+         * @brief Change the budget, evicting entries when it shrinks, 0 disables caching
+         */
+        void set_budget( size_t budget );
+
+        [[nodiscard]] content_cache_stats_t stats() const;
+
+    private:
+        struct item_t {
+            uint32_t key;
+            shared_content_t content;
+        };
+
+        void evict_to( size_t budget );
+
+        mutable std::mutex mutex_;
+        std::list< item_t > items_; // Most recently used first
+        std::unordered_map< uint32_t, std::list< item_t >::iterator > lookup_;
+        size_t budget_ = 0;
+        size_t bytes_ = 0;
+        uint64_t hits_ = 0;
+        uint64_t misses_ = 0;
+        uint64_t evictions_ = 0;
+    };
+
+} // namespace kspkg
\ No newline at end of file
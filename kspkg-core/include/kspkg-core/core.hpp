@@ -2,12 +2,22 @@
 
 #include <filesystem>
 #include <memory>
+#include <memory_resource>
 #include <span>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <string_view>
+#include <unordered_map>
 #include <expected>
+#include <functional>
+#include <ostream>
+
+#include "content_cache.hpp"
+#include "file_handle.hpp"
+#include "file_table.hpp"
+#include "mapped_file.hpp"
+#include "path_index.hpp"
 
 namespace kspkg {
 
@@ -15,59 +25,66 @@ namespace kspkg {
     using expected = std::expected< T, std::string >;
     using unexpected = std::unexpected< std::string >;
 
-    enum class file_flags_t : uint16_t {
-        kIsDirectory = 1 << 0,
-        kIsEncrypted = 1 << 8, // https://github.com/ntpopgetdope/ace-kspkg
-    };
-
-    struct file_desc_t {
-        char name[ 0xE0 ] {};
-        uint8_t gap0[ 0x4 ] {};
-        uint16_t flags;
-        uint16_t name_length;
-        size_t file_hash; // https://github.com/ntpopgetdope/ace-kspkg
-        size_t file_size;
-        size_t file_offset;
+    struct load_options_t {
+        bool memory_map = false;              // Map the package read-only instead of using positional reads
+        bool case_insensitive_lookup = false; // Ignore ASCII case in `package::find`
+        size_t concurrency = 0;               // Threads parsing the metadata, 0 means one per hardware thread
+        bool sidecar_index = false;           // Reuse `<package>.idx` when it matches the package, write it otherwise
+        size_t cache_budget = 0x4000000;      // Bytes kept by the content cache behind `package::extract_cached`, 64 MB
     };
 
-    class file {
-    public:
-        file() = default;
-        explicit file( const file_desc_t& desc ) : desc_( desc ) { }
-
-        [[nodiscard]] std::string_view get_name() const noexcept {
-            return { desc_.name, desc_.name_length };
-        }
+    constexpr size_t kDefaultChunkSize = 0x100000; // 1 MB
 
-        [[nodiscard]] bool is_directory() const noexcept {
-            return desc_.flags & static_cast< uint16_t >( file_flags_t::kIsDirectory );
-        }
-
-        [[nodiscard]] bool is_encrypted() const noexcept {
-            return desc_.flags & static_cast< uint16_t >( file_flags_t::kIsEncrypted );
-        }
+    /**
+     * @brief Receives decrypted file contents chunk by chunk, in order
+     */
+    using chunk_sink_t = std::function< expected< void >( std::span< const uint8_t > chunk ) >;
 
-        [[nodiscard]] size_t get_file_size() const noexcept {
-            return desc_.file_size;
-        }
+    enum class extract_backend_t {
+        kThreads, // Worker threads issuing positional reads
+        kIoUring, // One io_uring on the calling thread, Linux only, falls back to `kThreads` when unavailable
+    };
 
-        [[nodiscard]] size_t get_file_offset() const noexcept {
-            return desc_.file_offset;
-        }
+    struct extract_options_t {
+        size_t concurrency = 0; // Number of worker threads, 0 means one per hardware thread
+        extract_backend_t backend = extract_backend_t::kThreads;
+        size_t queue_depth = 64; // Requests in flight for `kIoUring`
+    };
 
-        [[nodiscard]] file_desc_t& desc() noexcept {
-            return desc_;
-        }
+    struct extract_result_t {
+        file entry;
+        expected< void > status;
+    };
 
-    private:
-        file_desc_t desc_;
+    struct extract_report_t {
+        size_t extracted = 0;
+        size_t failed = 0;
+        uint64_t bytes = 0;
+        extract_backend_t backend = extract_backend_t::kThreads; // Backend that actually ran
+        std::vector< extract_result_t > results;                 // Same order as the requested files
     };
 
+    /**
+     * @brief Loaded package
+     *
+     * Reads are positional (or served from the mapping), so one package can be extracted from several threads at once.
+     */
     class package {
     public:
         package() = default;
-        explicit package( std::ifstream stream, const std::filesystem::path& path, const std::vector< std::shared_ptr< file > >& files )
-            : stream_( std::move( stream ) ), path_( path ), files_( files ) { }
+        explicit package( detail::file_handle handle, const std::filesystem::path& path, file_table files,
+                          bool case_insensitive_lookup = false )
+            : handle_( std::move( handle ) ), path_( path ), files_( std::move( files ) ), index_( files_, case_insensitive_lookup ) { }
+        explicit package( detail::mapped_file mapping, const std::filesystem::path& path, file_table files,
+                          bool case_insensitive_lookup = false )
+            : mapping_( std::move( mapping ) ), path_( path ), files_( std::move( files ) ), index_( files_, case_insensitive_lookup ) { }
+        explicit package( detail::file_handle handle, const std::filesystem::path& path, file_table files, detail::path_index index )
+            : handle_( std::move( handle ) ), path_( path ), files_( std::move( files ) ), index_( std::move( index ) ) { }
+        explicit package( detail::mapped_file mapping, const std::filesystem::path& path, file_table files, detail::path_index index )
+            : mapping_( std::move( mapping ) ), path_( path ), files_( std::move( files ) ), index_( std::move( index ) ) { }
+
+        package( const package& ) = delete;
+        package& operator=( const package& ) = delete;
 
         [[nodiscard]] std::string get_name() const noexcept {
             return path_.filename().string();
@@ -77,44 +94,204 @@ namespace kspkg {
             return path_;
         }
 
-        [[nodiscard]] const std::vector< std::shared_ptr< file > >& get_files() const noexcept {
+        /**
+         * @note Handles returned from the table stay valid as long as the package is alive
+         */
+        [[nodiscard]] const file_table& get_files() const noexcept {
             return files_;
         }
 
+        [[nodiscard]] bool is_mapped() const noexcept {
+            return mapping_.is_open();
+        }
+
+        /**
+         * @brief Change the content cache budget, 0 disables the cache
+         */
+        void set_cache_budget( size_t budget ) {
+            cache_.set_budget( budget );
+        }
+
+        [[nodiscard]] content_cache_stats_t get_cache_stats() const {
+            return cache_.stats();
+        }
+
+        /**
+         * @brief Find file by its path inside the package
+         * @param path Path, `/` and `\` are interchangeable and leading, trailing or repeated separators are ignored
+         * @return Found file or an invalid handle
+         */
+        [[nodiscard]] file find( std::string_view path ) const;
+
+        /**
+         * @brief Point the file to new data, used when repacking
+         * @param file File to update
+         * @param offset New data offset in the package
+         * @param size New data size
+         */
+        void set_file_location( const file& file, uint64_t offset, uint64_t size );
+
         /**
          * @brief Extract file from the package
          * @param file File to extract
          * @param out_directory Directory to extract the file
          */
-        expected< bool > extract_file( const std::shared_ptr< file >& file, const std::filesystem::path& out_directory );
+        expected< bool > extract_file( const file& file, const std::filesystem::path& out_directory ) const;
 
         /**
          * @brief Extract file from the package
          * @param file Extracted file
          */
-        expected< std::vector< uint8_t > > extract_file( const std::shared_ptr< file >& file );
+        expected< std::vector< uint8_t > > extract_file( const file& file ) const;
+
+        /**
+         * @brief Extract file into a caller-provided buffer, nothing is allocated
+         * @param file Extracted file
+         * @param buffer Destination, at least `file.get_file_size()` bytes
+         * @return The front of `buffer` holding the file contents
+         */
+        expected< std::span< uint8_t > > extract_into( const file& file, std::span< uint8_t > buffer ) const;
+
+        /**
+         * @brief Extract file into a reusable buffer, it only grows when the file does not fit
+         * @param file Extracted file
+         * @param buffer Scratch buffer, e.g. one per thread backed by a pooled memory resource
+         * @return The front of `buffer` holding the file contents
+         */
+        expected< std::span< uint8_t > > extract_into( const file& file, std::pmr::vector< uint8_t >& buffer ) const;
+
+        /**
+         * @brief Read part of a file, decrypted with the key phase of its position inside the file
+         * @param file Read file
+         * @param offset Position inside the file
+         * @param buffer Destination, reads stop at the end of the file
+         * @return Number of bytes read, 0 at or past the end of the file
+         */
+        expected< size_t > read_range( const file& file, uint64_t offset, std::span< uint8_t > buffer ) const;
+
+        /**
+         * @brief Extract file through the content cache
+         * @param file Extracted file
+         * @return Shared immutable contents, a cached entry costs a lookup instead of a read and decrypt
+         */
+        expected< shared_content_t > extract_cached( const file& file ) const;
+
+        /**
+         * @brief Stream file contents in fixed-size chunks
+         * @param file File to extract
+         * @param sink Receiver of the decrypted chunks
+         * @param chunk_size Maximum size of one chunk, peak memory does not depend on the file size
+         */
+        expected< void > extract_to( const file& file, const chunk_sink_t& sink,
+                                     size_t chunk_size = kDefaultChunkSize ) const;
+
+        /**
+         * @brief Stream file contents to the output stream in fixed-size chunks
+         * @param file File to extract
+         * @param output Output stream
+         * @param chunk_size Maximum size of one chunk
+         */
+        expected< void > extract_to( const file& file, std::ostream& output,
+                                     size_t chunk_size = kDefaultChunkSize ) const;
+
+        /**
+         * @brief Stream file contents to the file descriptor in fixed-size chunks
+         * @param file File to extract
+         * @param fd Writable file descriptor
+         * @param chunk_size Maximum size of one chunk
+         */
+        expected< void > extract_to( const file& file, int fd, size_t chunk_size = kDefaultChunkSize ) const;
+
+        /**
+         * @brief Extract files from the package in parallel
+         * @param files Files to extract, directories are reported as failures
+         * @param out_directory Directory to extract the files
+         * @param options Extraction options
+         * @return Per-file results and totals
+         */
+        extract_report_t extract_many( const std::vector< file >& files, const std::filesystem::path& out_directory,
+                                       const extract_options_t& options = {} ) const;
+
+        /**
+         * @brief Extract every file of the package in parallel
+         * @param out_directory Directory to extract the files
+         * @param options Extraction options
+         * @return Per-file results and totals
+         */
+        extract_report_t extract_all( const std::filesystem::path& out_directory, const extract_options_t& options = {} ) const;
+
+        /**
+         * @brief View file contents without copying when possible
+         * @param file File to view
+         * @param buffer Scratch buffer for encrypted or non-mapped files
+         * @return View into the mapping for unencrypted files of a mapped package, otherwise a view into `buffer`
+         */
+        expected< std::span< const uint8_t > > view_file( const file& file, std::vector< uint8_t >& buffer ) const;
 
     private:
-        std::ifstream stream_;
+        expected< std::span< const uint8_t > > mapped_range( const file& file ) const;
+        expected< void > read_file( const file& file, std::vector< uint8_t >& buffer ) const;
+
+        detail::file_handle handle_;
+        detail::mapped_file mapping_;
         std::filesystem::path path_;
-        std::vector< std::shared_ptr< file > > files_;
+        file_table files_;
+        detail::path_index index_;
+        mutable content_cache cache_;
     };
 
     /**
      * @brief Load package from the file
      * @param path Path to the package file
+     * @param options Load options
      * @return Loaded package
      */
-    expected< std::shared_ptr< package > > load_package( const std::filesystem::path& path );
+    expected< std::shared_ptr< package > > load_package( const std::filesystem::path& path, const load_options_t& options = {} );
+
+    struct patch_options_t {
+        bool share_metadata_tail = false; // Store the empty slots of the new metadata block as shared extents, where reflinks work
+    };
 
     /**
      * @brief Repack package with new files
+     * @note Applying files from several virtual roots at once is cheaper through `patch_builder`, see `patch_builder.hpp`
      * @param package Package to repack
      * @param new_filespathes Pathes to the new files
      * @param new_files_root_dir Virtual root directory for the files
+     * @param options Patch options
      */
     expected< void > repack_package( const std::shared_ptr< package >& package, const std::vector< std::filesystem::path >& new_filespathes,
-                                     const std::filesystem::path& new_files_root_dir );
+                                     const std::filesystem::path& new_files_root_dir, const patch_options_t& options = {} );
+
+    enum class compact_layout_t {
+        kPackageOrder, // Keep the live data in its current order
+        kByPath,       // Group entries by directory and sort them by path, so every subtree is one contiguous range
+    };
+
+    struct compact_options_t {
+        compact_layout_t layout = compact_layout_t::kPackageOrder;
+        bool share_metadata_tail = false; // Same as `patch_options_t::share_metadata_tail`
+    };
+
+    struct compact_report_t {
+        uint64_t old_size = 0;
+        uint64_t new_size = 0;
+        uint64_t reclaimed = 0; // Superseded entry data, old metadata blocks, patch markers and footers dropped from the package
+        size_t runs = 0;        // Contiguous ranges of live data copied
+    };
+
+    /**
+     * @brief Rewrite the package with only the live entry data and one metadata block
+     *
+     * Live data is copied in the requested layout with large sequential copies, `copy_file_range` where the platform has it,
+     * into `<package>.compact.tmp`, which then replaces the package by an atomic rename. The output ends with a base footer in
+     * front of the metadata, `remove_patches` finds no patch in it afterwards, only patches applied later can be removed.
+     *
+     * @param package Package to compact
+     * @param options Layout of the rewritten data
+     * @note The loaded package still reads the old file, load it again afterwards
+     */
+    expected< compact_report_t > compact_package( const std::shared_ptr< package >& package, const compact_options_t& options = {} );
 
     /**
      * @brief Remove patches from the package
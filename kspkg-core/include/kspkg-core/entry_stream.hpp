@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "core.hpp"
+
+namespace kspkg {
+
+    constexpr size_t kDefaultStreamBufferSize = 0x1000; // 4 KB
+
+    /**
+     * @brief Seekable read-only stream buffer over one package entry
+     *
+     * Only the ranges that are actually read are fetched and decrypted, so sniffing a header or reading one line of a large entry
+     * costs a few KB instead of the whole entry.
+     */
+    class entry_streambuf : public std::streambuf {
+    public:
+        /**
+         * @param package Package holding the entry, kept alive by the stream buffer
+         * @param file Entry to read
+         * @param buffer_size Bytes fetched per read, larger reads go straight into the caller's memory
+         */
+        explicit entry_streambuf( std::shared_ptr< const package > package, file file, size_t buffer_size = kDefaultStreamBufferSize );
+
+        entry_streambuf( const entry_streambuf& ) = delete;
+        entry_streambuf& operator=( const entry_streambuf& ) = delete;
+
+        [[nodiscard]] const file& get_file() const noexcept {
+            return file_;
+        }
+
+        /**
+         * @brief Message of the last failed read, empty when no read failed
+         * @note A failed read looks like the end of the entry to the stream
+         */
+        [[nodiscard]] const std::string& get_error() const noexcept {
+            return error_;
+        }
+
+    protected:
+        int_type underflow() override;
+        std::streamsize xsgetn( char_type* data, std::streamsize count ) override;
+        std::streamsize showmanyc() override;
+        pos_type seekoff( off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which ) override;
+        pos_type seekpos( pos_type position, std::ios_base::openmode which ) override;
+
+    private:
+        /**
+         * @brief Position of `gptr()` inside the entry
+         */
+        [[nodiscard]] uint64_t position() const noexcept;
+
+        /**
+         * @brief Forget the buffered bytes, the next read starts at `position`
+         */
+        void reset_to( uint64_t position ) noexcept;
+
+        /**
+         * @brief Read at `position`, remembering the error when the read fails
+         * @return Number of bytes read, 0 at the end of the entry or on failure
+         */
+        size_t read( uint64_t position, char_type* data, size_t count );
+
+        std::shared_ptr< const package > package_;
+        file file_;
+        std::vector< char_type > buffer_;
+        uint64_t buffer_position_ = 0; // Position of `eback()` inside the entry
+        std::string error_;
+    };
+
+    /**
+     * @brief Input stream over one package entry, see `entry_streambuf`
+     */
+    class entry_istream : public std::istream {
+    public:
+        explicit entry_istream( std::shared_ptr< const package > package, file file, size_t buffer_size = kDefaultStreamBufferSize )
+            : std::istream( nullptr ), buffer_( std::move( package ), file, buffer_size ) {
+            rdbuf( &buffer_ );
+        }
+
+        [[nodiscard]] const entry_streambuf& buffer() const noexcept {
+            return buffer_;
+        }
+
+    private:
+        entry_streambuf buffer_;
+    };
+
+} // namespace kspkg
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <expected>
+
+namespace kspkg::detail {
+
+    enum class access_hint_t {
+        kSequential, // The range is read front to back, read ahead aggressively
+        kWillNeed,   // The range is read soon, start fetching it now
+        kNormal,     // Default read ahead, undoes `kSequential`
+    };
+
+    /**
+     * @brief Read-only file handle with positional reads
+     *
+     * Reads never touch a shared file cursor, so one handle can be used from several threads at once.
+     */
+    class file_handle {
+    public:
+        file_handle() = default;
+        ~file_handle();
+
+        file_handle( const file_handle& ) = delete;
+        file_handle& operator=( const file_handle& ) = delete;
+
+        file_handle( file_handle&& other ) noexcept;
+        file_handle& operator=( file_handle&& other ) noexcept;
+
+        /**
+         * @brief Open the file for reading
+         * @param path Path to the file
+         * @return Opened handle or an error message
+         */
+        static std::expected< file_handle, std::string > open( const std::filesystem::path& path );
+
+        [[nodiscard]] bool is_open() const noexcept;
+
+#ifdef _WIN32
+        [[nodiscard]] void* native_handle() const noexcept {
+            return handle_;
+        }
+#else
+        [[nodiscard]] int native_handle() const noexcept {
+            return fd_;
+        }
+#endif
+
+        /**
+         * @brief Current size of the file
+         */
+        [[nodiscard]] std::expected< uint64_t, std::string > size() const;
+
+        /**
+         * @brief Read exactly `buffer.size()` bytes starting at `offset`
+         * @param offset Absolute file offset
+         * @param buffer Destination buffer
+         */
+        [[nodiscard]] std::expected< void, std::string > read_at( uint64_t offset, std::span< uint8_t > buffer ) const;
+
+        /**
+         * @brief Tell the OS how a range is about to be read, a no-op where that is not supported
+         * @param length Range length, 0 means up to the end of the file
+         */
+        void advise( uint64_t offset, uint64_t length, access_hint_t hint ) const noexcept;
+
+    private:
+        void close() noexcept;
+
+#ifdef _WIN32
+        void* handle_ = nullptr;
+#else
+        int fd_ = -1;
+#endif
+    };
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kspkg {
+
+    enum class file_flags_t : uint16_t {
+        kIsDirectory = 1 << 0,
+        kIsEncrypted = 1 << 8, // https://github.com/ntpopgetdope/ace-kspkg
+    };
+
+    struct file_desc_t {
+        char name[ 0xE0 ] {};
+        uint8_t gap0[ 0x4 ] {};
+        uint16_t flags;
+        uint16_t name_length;
+        size_t file_hash; // https://github.com/ntpopgetdope/ace-kspkg
+        size_t file_size;
+        size_t file_offset;
+    };
+
+    static_assert( sizeof( file_desc_t ) == 0x100, "Descriptor layout must match the package format" );
+
+    constexpr size_t kMetadataSize = 0x2000000; // Encrypted descriptor table at the end of the package
+    constexpr size_t kMaxFileCount = kMetadataSize / sizeof( file_desc_t );
+
+    class file_table;
+
+    /**
+     * @brief Lightweight handle to an entry of a `file_table`
+     * @note Stays valid as long as the table (the owning package) is alive
+     */
+    class file {
+    public:
+        file() = default;
+        file( const file_table* table, uint32_t index ) : table_( table ), index_( index ) { }
+
+        [[nodiscard]] bool is_valid() const noexcept {
+            return table_ != nullptr;
+        }
+
+        explicit operator bool() const noexcept {
+            return is_valid();
+        }
+
+        [[nodiscard]] uint32_t get_index() const noexcept {
+            return index_;
+        }
+
+        [[nodiscard]] std::string_view get_name() const noexcept;
+        [[nodiscard]] bool is_directory() const noexcept;
+        [[nodiscard]] bool is_encrypted() const noexcept;
+        [[nodiscard]] size_t get_file_size() const noexcept;
+        [[nodiscard]] size_t get_file_offset() const noexcept;
+        [[nodiscard]] size_t get_file_hash() const noexcept;
+
+        /**
+         * @brief Rebuild the on-disk descriptor of the entry
+         */
+        [[nodiscard]] file_desc_t desc() const noexcept;
+
+        bool operator==( const file& ) const = default;
+
+    private:
+        const file_table* table_ = nullptr;
+        uint32_t index_ = 0;
+    };
+
+    /**
+     * @brief Package entries stored column by column
+     *
+     * Offsets, sizes, hashes and flags live in parallel arrays and names are interned into one pool,
+     * so scans over the table touch contiguous memory and each entry costs a few dozen bytes.
+     */
+    class file_table {
+    public:
+        class iterator {
+        public:
+            using iterator_concept = std::forward_iterator_tag;
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = file;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+            iterator( const file_table* table, uint32_t index ) : table_( table ), index_( index ) { }
+
+            file operator*() const noexcept {
+                return { table_, index_ };
+            }
+
+            iterator& operator++() noexcept {
+                ++index_;
+                return *this;
+            }
+
+            iterator operator++( int ) noexcept {
+                auto copy = *this;
+                ++index_;
+                return copy;
+            }
+
+            bool operator==( const iterator& ) const = default;
+
+        private:
+            const file_table* table_ = nullptr;
+            uint32_t index_ = 0;
+        };
+
+        [[nodiscard]] size_t size() const noexcept {
+            return offsets_.size();
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return offsets_.empty();
+        }
+
+        [[nodiscard]] file operator[]( size_t index ) const noexcept {
+            return { this, static_cast< uint32_t >( index ) };
+        }
+
+        [[nodiscard]] iterator begin() const noexcept {
+            return { this, 0 };
+        }
+
+        [[nodiscard]] iterator end() const noexcept {
+            return { this, static_cast< uint32_t >( size() ) };
+        }
+
+        [[nodiscard]] std::string_view name( size_t index ) const noexcept {
+            return { names_.data() + name_offsets_[ index ], name_lengths_[ index ] };
+        }
+
+        [[nodiscard]] std::span< const uint64_t > offsets() const noexcept {
+            return offsets_;
+        }
+
+        [[nodiscard]] std::span< const uint64_t > sizes() const noexcept {
+            return sizes_;
+        }
+
+        [[nodiscard]] std::span< const uint64_t > hashes() const noexcept {
+            return hashes_;
+        }
+
+        [[nodiscard]] std::span< const uint16_t > flags() const noexcept {
+            return flags_;
+        }
+
+        void reserve( size_t count );
+
+        /**
+         * @brief Append an entry, the name is copied into the pool
+         */
+        void push_back( const file_desc_t& desc );
+
+        /**
+         * @brief Append every entry of another table, in its order
+         */
+        void append( const file_table& other );
+
+        /**
+         * @brief Point an entry to new data
+         */
+        void set_location( size_t index, uint64_t offset, uint64_t size ) noexcept {
+            offsets_[ index ] = offset;
+            sizes_[ index ] = size;
+        }
+
+        /**
+         * @brief Rebuild the on-disk descriptor of an entry
+         */
+        [[nodiscard]] file_desc_t desc( size_t index ) const noexcept;
+
+        /**
+         * @brief Append the columns to `out`
+         */
+        void serialize( std::vector< uint8_t >& out ) const;
+
+        /**
+         * @brief Restore a table written by `serialize` and advance `data` past it
+         * @return False when the data is malformed, the table is left empty
+         */
+        bool deserialize( std::span< const uint8_t >& data );
+
+        /**
+         * @brief Heap memory owned by the table, in bytes
+         */
+        [[nodiscard]] size_t memory_usage() const noexcept;
+
+    private:
+        std::vector< uint64_t > offsets_;
+        std::vector< uint64_t > sizes_;
+        std::vector< uint64_t > hashes_;
+        std::vector< uint32_t > name_offsets_;
+        std::vector< uint16_t > name_lengths_;
+        std::vector< uint16_t > flags_;
+        std::vector< uint32_t > reserved_; // `file_desc_t::gap0`, kept so descriptors round-trip
+        std::string names_;                // Names are NUL-terminated inside the pool
+    };
+
+    inline std::string_view file::get_name() const noexcept {
+        return table_->name( index_ );
+    }
+
+    inline bool file::is_directory() const noexcept {
+        return table_->flags()[ index_ ] & static_cast< uint16_t >( file_flags_t::kIsDirectory );
+    }
+
+    inline bool file::is_encrypted() const noexcept {
+        return table_->flags()[ index_ ] & static_cast< uint16_t >( file_flags_t::kIsEncrypted );
+    }
+
+    inline size_t file::get_file_size() const noexcept {
+        return table_->sizes()[ index_ ];
+    }
+
+    inline size_t file::get_file_offset() const noexcept {
+        return table_->offsets()[ index_ ];
+    }
+
+    inline size_t file::get_file_hash() const noexcept {
+        return table_->hashes()[ index_ ];
+    }
+
+    inline file_desc_t file::desc() const noexcept {
+        return table_->desc( index_ );
+    }
+
+} // namespace kspkg
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace kspkg {
+
+    enum class size_distribution_t {
+        kUniform,    // Sizes spread evenly between the bounds
+        kLogUniform, // Many small entries and a few large ones, closer to real packages
+    };
+
+    struct generator_options_t {
+        size_t entry_count = 1000;
+        uint64_t min_file_size = 0;
+        uint64_t max_file_size = 0x10000;
+        size_distribution_t size_distribution = size_distribution_t::kLogUniform;
+        double encrypted_ratio = 0.5; // Share of entries stored encrypted, 0..1
+        size_t directory_depth = 3;   // Maximum number of directories above an entry
+        size_t directory_fanout = 8;  // Distinct directory names per level
+        uint64_t seed = 1;
+    };
+
+    struct generated_entry_t {
+        std::string name;
+        uint64_t file_size = 0;
+        uint64_t file_offset = 0;
+        bool is_encrypted = false;
+    };
+
+    /**
+     * @brief Write a synthetic package with the same layout as a real one
+     *
+     * Entry data is written back to back, followed by the encrypted `kMetadataSize` descriptor table.
+     * The output only depends on the options, so the same seed always gives the same package.
+     *
+     * @param path Path to the package file to create
+     * @param options Generator options
+     * @return Description of every written entry, in descriptor order
+     */
+    expected< std::vector< generated_entry_t > > generate_package( const std::filesystem::path& path,
+                                                                   const generator_options_t& options = {} );
+
+    /**
+     * @brief Decrypted contents the generator writes for an entry
+     * @param options Options the package was generated with
+     * @param index Entry index in descriptor order
+     * @param file_size Entry size
+     */
+    std::vector< uint8_t > generated_entry_content( const generator_options_t& options, size_t index, uint64_t file_size );
+
+} // namespace kspkg
\ No newline at end of file
@@ -1,3 +1,8 @@
 #pragma once
 
-#include "core.hpp"
\ No newline at end of file
+#include "cipher.hpp"
+#include "core.hpp"
+#include "entry_stream.hpp"
+#include "generator.hpp"
+#include "patch_builder.hpp"
+#include "patch_stack.hpp"
\ No newline at end of file
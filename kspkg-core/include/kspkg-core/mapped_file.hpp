@@ -0,0 +1,63 @@
+#pragma once
+
+#include "file_handle.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <expected>
+
+namespace kspkg::detail {
+
+    /**
+     * @brief Read-only memory mapping of a whole file
+     */
+    class mapped_file {
+    public:
+        mapped_file() = default;
+        ~mapped_file();
+
+        mapped_file( const mapped_file& ) = delete;
+        mapped_file& operator=( const mapped_file& ) = delete;
+
+        mapped_file( mapped_file&& other ) noexcept;
+        mapped_file& operator=( mapped_file&& other ) noexcept;
+
+        /**
+         * @brief Map the file read-only
+         * @param path Path to the file
+         * @return Mapped file or an error message
+         */
+        static std::expected< mapped_file, std::string > open( const std::filesystem::path& path );
+
+        [[nodiscard]] bool is_open() const noexcept {
+            return data_ != nullptr;
+        }
+
+        [[nodiscard]] std::span< const uint8_t > data() const noexcept {
+            return { data_, size_ };
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return size_;
+        }
+
+        /**
+         * @brief Tell the OS how a range of the mapping is about to be read, a no-op where that is not supported
+         * @param length Range length, 0 means up to the end of the file
+         */
+        void advise( uint64_t offset, uint64_t length, access_hint_t hint ) const noexcept;
+
+    private:
+        void close() noexcept;
+
+        const uint8_t* data_ = nullptr;
+        size_t size_ = 0;
+#ifdef _WIN32
+        void* file_handle_ = nullptr;
+        void* mapping_handle_ = nullptr;
+#endif
+    };
+
+} // namespace kspkg::detail
\ No newline at end of file
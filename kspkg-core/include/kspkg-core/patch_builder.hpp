@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "core.hpp"
+
+namespace kspkg {
+
+    /**
+     * @brief Collects replacement files and applies them to the package as one patch
+     *
+     * Every `repack_package` call appends its own marker and a full metadata block. The builder stages files from any number
+     * of virtual roots and writes them on `commit` with one sequential append and a single metadata block.
+     */
+    class patch_builder {
+    public:
+        explicit patch_builder( std::shared_ptr< package > package ) : package_( std::move( package ) ) { }
+
+        patch_builder( const patch_builder& ) = delete;
+        patch_builder& operator=( const patch_builder& ) = delete;
+
+        /**
+         * @brief Stage files replacing entries under the virtual root
+         * @param new_filespathes Pathes to the new files, files that do not exist or match no entry are skipped
+         * @param new_files_root_dir Virtual root directory for the files
+         * @return Number of staged files
+         */
+        size_t stage( const std::vector< std::filesystem::path >& new_filespathes, const std::filesystem::path& new_files_root_dir );
+
+        /**
+         * @brief Stage a file replacing the entry, a later stage of the same entry wins
+         * @return False when the file does not exist or the entry is a directory
+         */
+        bool stage( const file& entry, const std::filesystem::path& new_filepath );
+
+        [[nodiscard]] size_t staged_count() const noexcept {
+            return staged_.size();
+        }
+
+        /**
+         * @brief Total size of the staged files, as measured when they were staged
+         */
+        [[nodiscard]] uint64_t staged_bytes() const noexcept;
+
+        void clear();
+
+        /**
+         * @brief Append the staged data and the metadata to the package
+         *
+         * A patch is the marker, the data, a footer pointing back to the marker and to the previous patch, and the metadata.
+         *
+         * Either every staged file is applied or the package is truncated back and the entries keep their locations.
+         * Nothing is written when nothing is staged. The builder is empty afterwards.
+         *
+         * When every staged file fits into the current data of its entry and that data belongs to the newest patch, the data
+         * and the affected descriptors are overwritten in place instead, the package does not grow. Data older than the newest
+         * patch is never overwritten, so `remove_patches` still restores the package to before that patch. Up to 64 MB in total,
+         * every staged file is read before the first byte is overwritten, a source that cannot be read or changed size falls back
+         * to appending, and a failed write puts the overwritten bytes back. The `.idx` sidecar is deleted, the package size
+         * stays the same.
+         *
+         * Entries of the base package are always appended, however small the change: their original bytes would have to be
+         * kept somewhere to restore them, and a package has no room for that behind its metadata block. The overwritten bytes
+         * are only held in memory, so a crash during an in-place update can leave the newest patch half written. Its footer and
+         * everything in front of it stay intact, `remove_patches` still drops that patch.
+         */
+        expected< void > commit( const patch_options_t& options = {} );
+
+    private:
+        /**
+         * @return False when the staged files do not qualify for an in-place update, nothing has been written then
+         */
+        expected< bool > commit_in_place();
+        expected< void > commit_appended( const patch_options_t& options );
+
+        struct staged_t {
+            file entry;
+            std::filesystem::path source;
+            uint64_t size = 0;
+        };
+
+        std::shared_ptr< package > package_;
+        std::vector< staged_t > staged_;
+        std::unordered_map< uint32_t, size_t > positions_; // Entry index to its position in `staged_`
+    };
+
+} // namespace kspkg
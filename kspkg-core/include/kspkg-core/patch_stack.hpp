@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core.hpp"
+
+namespace kspkg {
+
+    /**
+     * @brief One generation of a package, the base package or one patch on top of it
+     */
+    struct patch_generation_t {
+        uint64_t offset = 0;               // Where the generation starts, the base starts at 0
+        uint64_t size = 0;                 // Bytes of the generation, for a patch its marker, data, footer and metadata
+        int64_t created = 0;               // Seconds since the Unix epoch, 0 for the base
+        std::vector< std::string > touched; // Entries pointed to new data compared to the previous generation
+    };
+
+    /**
+     * @brief List the generations of the package, oldest first, the base package is generation 0
+     *
+     * Generations are found through the patch footers, only the footers and the metadata blocks at generation boundaries are
+     * read. Patches written without a footer count as part of the generation below them, a newest patch without a footer
+     * hides the generations below it.
+     *
+     * @param package Package to inspect
+     * @param touched_entries Diff the metadata blocks to fill `patch_generation_t::touched`, otherwise only footers are read
+     */
+    expected< std::vector< patch_generation_t > > list_patches( const std::shared_ptr< package >& package, bool touched_entries = true );
+
+    /**
+     * @brief Remove every patch above the generation
+     * @param package Package to roll back
+     * @param generation Generation that becomes the newest one, 0 restores the base package
+     * @note The loaded package keeps the entries of the newest generation, load it again afterwards
+     */
+    expected< void > roll_back_patches( const std::shared_ptr< package >& package, size_t generation );
+
+} // namespace kspkg
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "file_table.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kspkg::detail {
+
+    /**
+     * @brief Normalize a package path for lookups
+     *
+     * `\` and `/` collapse to a single `/`, leading and trailing separators are dropped
+     * and ASCII letters are lowercased when `case_insensitive` is set.
+     */
+    std::string normalize_path( std::string_view path, bool case_insensitive );
+
+    /**
+     * @brief Open-addressing hash index from normalized path to entry position
+     *
+     * Only path hashes and 32-bit positions are stored, names are compared against the table on a hash match,
+     * so the index can be written to a sidecar and read back without rebuilding it.
+     */
+    class path_index {
+    public:
+        static constexpr uint32_t kNotFound = UINT32_MAX;
+
+        path_index() = default;
+        path_index( const file_table& files, bool case_insensitive );
+
+        /**
+         * @brief Find an entry, the first one wins when several normalize to the same path
+         * @param files Table the index was built from
+         * @param path Path in any separator style
+         * @return Entry position, or `kNotFound`
+         */
+        [[nodiscard]] uint32_t find( const file_table& files, std::string_view path ) const;
+
+        [[nodiscard]] bool is_case_insensitive() const noexcept {
+            return case_insensitive_;
+        }
+
+        /**
+         * @brief Append the index to `out`
+         */
+        void serialize( std::vector< uint8_t >& out ) const;
+
+        /**
+         * @brief Restore an index written by `serialize` and advance `data` past it
+         * @param data Serialized index
+         * @param entry_count Number of entries in the table the index belongs to
+         * @return False when the data is malformed
+         */
+        bool deserialize( std::span< const uint8_t >& data, size_t entry_count );
+
+    private:
+        [[nodiscard]] uint32_t find_normalized( const file_table& files, std::string_view normalized, uint64_t hash ) const;
+
+        std::vector< uint64_t > hashes_; // Hash of every entry's normalized path, by position
+        std::vector< uint32_t > slots_;  // Position + 1, 0 marks an empty slot, the size is a power of two
+        bool case_insensitive_ = false;
+    };
+
+} // namespace kspkg::detail
\ No newline at end of file
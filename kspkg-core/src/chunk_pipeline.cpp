@@ -0,0 +1,183 @@
+#include "chunk_pipeline.hpp"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace kspkg::detail {
+
+    namespace {
+
+        enum class stage_t {
+            kFree,  // Waiting for the reader
+            kRead,  // Waiting for the transform
+            kReady, // Waiting for the writer
+        };
+
+        struct slot_t {
+            std::unique_ptr< uint8_t[] > data;
+            size_t length = 0;
+            stage_t stage = stage_t::kFree;
+        };
+
+        /**
+         * @brief Calls the function when it goes out of scope, including during stack unwinding
+         */
+        template < typename function_t >
+        struct scope_exit_t {
+            function_t function;
+
+            ~scope_exit_t() {
+                function();
+            }
+        };
+
+        template < typename function_t >
+        scope_exit_t( function_t ) -> scope_exit_t< function_t >;
+
+    } // namespace
+
+    expected< void > run_chunk_pipeline( uint64_t total, size_t chunk_size, const chunk_reader_t& read, const chunk_transform_t& transform,
+                                         const chunk_sink_t& write ) {
+        chunk_size = std::max< size_t >( chunk_size, 1 );
+        const size_t stage_size = std::max( chunk_size, kPipelineChunkSize );
+        const uint64_t chunk_count = ( total + stage_size - 1 ) / stage_size;
+
+        std::array< slot_t, kPipelineDepth > slots;
+        for ( auto& slot : slots ) {
+            slot.data = std::make_unique_for_overwrite< uint8_t[] >( static_cast< size_t >( std::min< uint64_t >( stage_size, total ) ) );
+        }
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool stopped = false;
+        std::optional< std::string > error;
+
+        const auto fail = [ & ]( std::string message ) {
+            {
+                std::scoped_lock lock( mutex );
+                stopped = true;
+                if ( !error )
+                    error = std::move( message );
+            }
+            changed.notify_all();
+        };
+
+        // A throwing stage on a worker thread would terminate the process, it fails the pipeline instead
+        const auto guarded = [ & ]( const auto& stage ) {
+            try {
+                return stage();
+            }
+            catch ( const std::exception& exception ) {
+                fail( exception.what() );
+            }
+            catch ( ... ) {
+                fail( "Pipeline stage failed." );
+            }
+            return false;
+        };
+
+        // Returns false once another stage failed
+        const auto wait_for = [ & ]( slot_t& slot, stage_t stage ) {
+            std::unique_lock lock( mutex );
+            changed.wait( lock, [ & ] { return stopped || slot.stage == stage; } );
+            return !stopped;
+        };
+
+        const auto hand_over = [ & ]( slot_t& slot, stage_t stage ) {
+            {
+                std::scoped_lock lock( mutex );
+                slot.stage = stage;
+            }
+            changed.notify_all();
+        };
+
+        {
+            std::jthread reader( [ & ] {
+                for ( uint64_t i = 0; i < chunk_count; i++ ) {
+                    auto& slot = slots[ i % kPipelineDepth ];
+                    if ( !wait_for( slot, stage_t::kFree ) )
+                        return;
+
+                    const uint64_t position = i * stage_size;
+                    slot.length = static_cast< size_t >( std::min< uint64_t >( stage_size, total - position ) );
+
+                    const bool read_ok = guarded( [ & ] {
+                        if ( const auto result = read( position, std::span( slot.data.get(), slot.length ) ); !result ) {
+                            fail( result.error() );
+                            return false;
+                        }
+                        return true;
+                    } );
+
+                    if ( !read_ok )
+                        return;
+
+                    hand_over( slot, transform ? stage_t::kRead : stage_t::kReady );
+                }
+            } );
+
+            std::jthread transformer;
+            if ( transform ) {
+                transformer = std::jthread( [ & ] {
+                    for ( uint64_t i = 0; i < chunk_count; i++ ) {
+                        auto& slot = slots[ i % kPipelineDepth ];
+                        if ( !wait_for( slot, stage_t::kRead ) )
+                            return;
+
+                        if ( !guarded( [ & ] {
+                                 transform( i * stage_size, std::span( slot.data.get(), slot.length ) );
+                                 return true;
+                             } ) )
+                            return;
+
+                        hand_over( slot, stage_t::kReady );
+                    }
+                } );
+            }
+
+            // Destroyed before the threads are joined, so however the writer leaves, even by an exception from `write`,
+            // stages blocked on a slot wake up and return
+            const scope_exit_t stop_stages { [ & ] {
+                {
+                    std::scoped_lock lock( mutex );
+                    stopped = true;
+                }
+                changed.notify_all();
+            } };
+
+            for ( uint64_t i = 0; i < chunk_count; i++ ) {
+                auto& slot = slots[ i % kPipelineDepth ];
+                if ( !wait_for( slot, stage_t::kReady ) )
+                    break;
+
+                // Stage chunks are coarse to keep the hand-offs rare, the writer still sees `chunk_size` pieces
+                std::span< const uint8_t > chunk( slot.data.get(), slot.length );
+                for ( ; !chunk.empty(); chunk = chunk.subspan( std::min( chunk.size(), chunk_size ) ) ) {
+                    if ( const auto result = write( chunk.first( std::min( chunk.size(), chunk_size ) ) ); !result ) {
+                        fail( result.error() );
+                        break;
+                    }
+                }
+
+                if ( !chunk.empty() )
+                    break;
+
+                hand_over( slot, stage_t::kFree );
+            }
+        } // Joins the stage threads
+
+        if ( error ) {
+            return unexpected( *error );
+        }
+
+        return {};
+    }
+
+} // namespace kspkg::detail
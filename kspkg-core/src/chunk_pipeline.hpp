@@ -0,0 +1,37 @@
+#pragma once
+
+#include <kspkg-core/core.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+namespace kspkg::detail {
+
+    constexpr size_t kPipelineDepth = 3;               // Chunks alive at once, one per stage
+    constexpr size_t kPipelineChunkSize = 0x400000;    // 4 MB, smallest chunk passed between the stages
+    constexpr uint64_t kPipelineThreshold = 0x2000000; // 32 MB, smaller entries are not worth the extra threads
+
+    using chunk_reader_t = std::function< expected< void >( uint64_t position, std::span< uint8_t > chunk ) >;
+    using chunk_transform_t = std::function< void( uint64_t position, std::span< uint8_t > chunk ) >;
+
+    /**
+     * @brief Process consecutive chunks with reading, transforming and writing overlapped on separate threads
+     *
+     * Chunks cycle through `kPipelineDepth` buffers, so while one chunk is written the next one is transformed
+     * and the one after it is read. Stages pass chunks of at least `kPipelineChunkSize` bytes,
+     * `write` still receives them in pieces of at most `chunk_size`. Peak memory is `kPipelineDepth` stage chunks.
+     *
+     * @param total Bytes to process
+     * @param chunk_size Maximum size of one chunk handed to `write`
+     * @param read Fills the chunk at the given position, runs on its own thread
+     * @param transform Changes the chunk in place, runs on its own thread, skipped when empty
+     * @param write Receives the chunks in order, runs on the calling thread
+     * @return The first error of any stage, the other stages stop at their next chunk. An exception from `read` or `transform`
+     *         is returned as an error, one from `write` propagates once the other stages have stopped
+     */
+    expected< void > run_chunk_pipeline( uint64_t total, size_t chunk_size, const chunk_reader_t& read, const chunk_transform_t& transform,
+                                         const chunk_sink_t& write );
+
+} // namespace kspkg::detail
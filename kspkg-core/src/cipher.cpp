@@ -0,0 +1,208 @@
+#include <kspkg-core/cipher.hpp>
+
+#include <cstring>
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+    #define KSPKG_CIPHER_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+#if defined( KSPKG_CIPHER_X86 ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+    #define KSPKG_TARGET( isa ) __attribute__( ( target( isa ) ) )
+#else
+    #define KSPKG_TARGET( isa )
+#endif
+
+namespace kspkg::detail {
+
+    namespace {
+
+        using kernel_t = void ( * )( uint8_t* data, size_t size, size_t key ) noexcept;
+
+        void xor_scalar( uint8_t* data, size_t size, size_t key ) noexcept {
+            size_t i = 0;
+
+            for ( ; i + sizeof( size_t ) <= size; i += sizeof( size_t ) ) {
+                size_t block;
+                std::memcpy( &block, data + i, sizeof( block ) );
+                block ^= key;
+                std::memcpy( data + i, &block, sizeof( block ) );
+            }
+
+            // Tail keeps walking the key byte by byte
+            for ( ; i < size; ++i ) {
+                data[ i ] ^= static_cast< uint8_t >( key );
+                key >>= 8;
+            }
+        }
+
+#ifdef KSPKG_CIPHER_X86
+        // Vector widths are multiples of the key size, so the scalar tail always starts on the key boundary
+
+        KSPKG_TARGET( "sse2" ) void xor_sse2( uint8_t* data, size_t size, size_t key ) noexcept {
+            const __m128i k = _mm_set1_epi64x( static_cast< long long >( key ) );
+            size_t i = 0;
+
+            for ( ; i + 64 <= size; i += 64 ) {
+                auto* p = reinterpret_cast< __m128i* >( data + i );
+                const __m128i a = _mm_loadu_si128( p + 0 );
+                const __m128i b = _mm_loadu_si128( p + 1 );
+                const __m128i c = _mm_loadu_si128( p + 2 );
+                const __m128i d = _mm_loadu_si128( p + 3 );
+                _mm_storeu_si128( p + 0, _mm_xor_si128( a, k ) );
+                _mm_storeu_si128( p + 1, _mm_xor_si128( b, k ) );
+                _mm_storeu_si128( p + 2, _mm_xor_si128( c, k ) );
+                _mm_storeu_si128( p + 3, _mm_xor_si128( d, k ) );
+            }
+
+            for ( ; i + 16 <= size; i += 16 ) {
+                auto* p = reinterpret_cast< __m128i* >( data + i );
+                _mm_storeu_si128( p, _mm_xor_si128( _mm_loadu_si128( p ), k ) );
+            }
+
+            xor_scalar( data + i, size - i, key );
+        }
+
+        KSPKG_TARGET( "avx2" ) void xor_avx2( uint8_t* data, size_t size, size_t key ) noexcept {
+            const __m256i k = _mm256_set1_epi64x( static_cast< long long >( key ) );
+            size_t i = 0;
+
+            for ( ; i + 128 <= size; i += 128 ) {
+                auto* p = reinterpret_cast< __m256i* >( data + i );
+                const __m256i a = _mm256_loadu_si256( p + 0 );
+                const __m256i b = _mm256_loadu_si256( p + 1 );
+                const __m256i c = _mm256_loadu_si256( p + 2 );
+                const __m256i d = _mm256_loadu_si256( p + 3 );
+                _mm256_storeu_si256( p + 0, _mm256_xor_si256( a, k ) );
+                _mm256_storeu_si256( p + 1, _mm256_xor_si256( b, k ) );
+                _mm256_storeu_si256( p + 2, _mm256_xor_si256( c, k ) );
+                _mm256_storeu_si256( p + 3, _mm256_xor_si256( d, k ) );
+            }
+
+            for ( ; i + 32 <= size; i += 32 ) {
+                auto* p = reinterpret_cast< __m256i* >( data + i );
+                _mm256_storeu_si256( p, _mm256_xor_si256( _mm256_loadu_si256( p ), k ) );
+            }
+
+            xor_scalar( data + i, size - i, key );
+        }
+
+        KSPKG_TARGET( "avx512f" ) void xor_avx512( uint8_t* data, size_t size, size_t key ) noexcept {
+            const __m512i k = _mm512_set1_epi64( static_cast< long long >( key ) );
+            size_t i = 0;
+
+            for ( ; i + 256 <= size; i += 256 ) {
+                auto* p = reinterpret_cast< __m512i* >( data + i );
+                const __m512i a = _mm512_loadu_si512( p + 0 );
+                const __m512i b = _mm512_loadu_si512( p + 1 );
+                const __m512i c = _mm512_loadu_si512( p + 2 );
+                const __m512i d = _mm512_loadu_si512( p + 3 );
+                _mm512_storeu_si512( p + 0, _mm512_xor_si512( a, k ) );
+                _mm512_storeu_si512( p + 1, _mm512_xor_si512( b, k ) );
+                _mm512_storeu_si512( p + 2, _mm512_xor_si512( c, k ) );
+                _mm512_storeu_si512( p + 3, _mm512_xor_si512( d, k ) );
+            }
+
+            for ( ; i + 64 <= size; i += 64 ) {
+                auto* p = reinterpret_cast< __m512i* >( data + i );
+                _mm512_storeu_si512( p, _mm512_xor_si512( _mm512_loadu_si512( p ), k ) );
+            }
+
+            xor_scalar( data + i, size - i, key );
+        }
+
+        bool cpu_supports( cipher_isa_t isa ) noexcept {
+    #ifdef _MSC_VER
+            int regs[ 4 ] {};
+            __cpuid( regs, 0 );
+            const int max_leaf = regs[ 0 ];
+
+            __cpuid( regs, 1 );
+            const bool sse2 = regs[ 3 ] & ( 1 << 26 );
+            const bool osxsave = regs[ 2 ] & ( 1 << 27 );
+            const bool avx = regs[ 2 ] & ( 1 << 28 );
+            const uint64_t xcr0 = osxsave ? _xgetbv( 0 ) : 0;
+
+            int ext[ 4 ] {};
+            if ( max_leaf >= 7 )
+                __cpuidex( ext, 7, 0 );
+
+            switch ( isa ) {
+            case cipher_isa_t::kSse2:
+                return sse2;
+            case cipher_isa_t::kAvx2:
+                return avx && ( xcr0 & 0x6 ) == 0x6 && ( ext[ 1 ] & ( 1 << 5 ) );
+            case cipher_isa_t::kAvx512:
+                return ( xcr0 & 0xE6 ) == 0xE6 && ( ext[ 1 ] & ( 1 << 16 ) );
+            default:
+                return true;
+            }
+    #else
+            // libgcc also checks that the OS saves the extended register state
+            switch ( isa ) {
+            case cipher_isa_t::kSse2:
+                return __builtin_cpu_supports( "sse2" );
+            case cipher_isa_t::kAvx2:
+                return __builtin_cpu_supports( "avx2" );
+            case cipher_isa_t::kAvx512:
+                return __builtin_cpu_supports( "avx512f" );
+            default:
+                return true;
+            }
+    #endif
+        }
+#endif
+
+        kernel_t kernel_for( cipher_isa_t isa ) noexcept {
+            switch ( isa ) {
+#ifdef KSPKG_CIPHER_X86
+            case cipher_isa_t::kSse2:
+                return xor_sse2;
+            case cipher_isa_t::kAvx2:
+                return xor_avx2;
+            case cipher_isa_t::kAvx512:
+                return xor_avx512;
+#endif
+            default:
+                return xor_scalar;
+            }
+        }
+
+    } // namespace
+
+    bool is_cipher_isa_supported( cipher_isa_t isa ) noexcept {
+        if ( isa == cipher_isa_t::kScalar )
+            return true;
+
+#ifdef KSPKG_CIPHER_X86
+        return cpu_supports( isa );
+#else
+        return false;
+#endif
+    }
+
+    cipher_isa_t best_cipher_isa() noexcept {
+        static const cipher_isa_t best = [] {
+            for ( const auto isa : { cipher_isa_t::kAvx512, cipher_isa_t::kAvx2, cipher_isa_t::kSse2 } ) {
+                if ( is_cipher_isa_supported( isa ) )
+                    return isa;
+            }
+            return cipher_isa_t::kScalar;
+        }();
+
+        return best;
+    }
+
+    void encrypt_decrypt_data( std::span< uint8_t > data, size_t key ) noexcept {
+        static const kernel_t kernel = kernel_for( best_cipher_isa() );
+        kernel( data.data(), data.size(), key );
+    }
+
+    void encrypt_decrypt_data( std::span< uint8_t > data, size_t key, cipher_isa_t isa ) noexcept {
+        kernel_for( isa )( data.data(), data.size(), key );
+    }
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include <kspkg-core/core.hpp>
+
+#include "metadata.hpp"
+#include "patch_format.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+    #include <fstream>
+#else
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace kspkg {
+
+    namespace {
+
+        constexpr size_t kCopyBufferSize = 0x800000; // 8 MB, used where the data cannot be copied inside the kernel
+
+        /**
+         * @brief Source range copied to the compacted package as a whole
+         */
+        struct copy_run_t {
+            uint64_t source = 0;
+            uint64_t length = 0;
+        };
+
+        /**
+         * @brief Append-only output file with an in-kernel copy from the package where available
+         */
+        class compact_output_t {
+        public:
+            compact_output_t() = default;
+            ~compact_output_t() {
+                close();
+            }
+
+            compact_output_t( const compact_output_t& ) = delete;
+            compact_output_t& operator=( const compact_output_t& ) = delete;
+
+            bool open( const std::filesystem::path& path ) {
+#ifdef _WIN32
+                stream_.open( path, std::ios::binary | std::ios::trunc );
+                return stream_.is_open();
+#else
+                fd_ = ::open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+                return fd_ >= 0;
+#endif
+            }
+
+            bool write( std::span< const uint8_t > data ) {
+#ifdef _WIN32
+                stream_.write( reinterpret_cast< const char* >( data.data() ), static_cast< std::streamsize >( data.size() ) );
+                return stream_.good();
+#else
+                while ( !data.empty() ) {
+                    const ssize_t written = ::write( fd_, data.data(), data.size() );
+                    if ( written < 0 && errno == EINTR )
+                        continue;
+                    if ( written <= 0 )
+                        return false;
+
+                    data = data.subspan( static_cast< size_t >( written ) );
+                }
+                return true;
+#endif
+            }
+
+            /**
+             * @brief Append `length` bytes of the source starting at `offset`
+             */
+            expected< void > copy( const detail::file_handle& source, uint64_t offset, uint64_t length ) {
+#if defined( __linux__ )
+                // Stays inside the kernel, and shares extents on file systems that support reflinks
+                while ( length != 0 && !buffered_only_ ) {
+                    auto in_offset = static_cast< off_t >( offset );
+                    const ssize_t copied = ::copy_file_range( source.native_handle(), &in_offset, fd_, nullptr, length, 0 );
+                    if ( copied < 0 && errno == EINTR )
+                        continue;
+
+                    if ( copied <= 0 ) {
+                        // Not supported between these files, the rest of the package goes through the buffer
+                        if ( copied < 0 && ( errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP ) ) {
+                            buffered_only_ = true;
+                            break;
+                        }
+                        return unexpected( "Failed to copy the package data." );
+                    }
+
+                    offset += static_cast< uint64_t >( copied );
+                    length -= static_cast< uint64_t >( copied );
+                }
+#endif
+
+                if ( length != 0 && !buffer_ )
+                    buffer_ = std::make_unique_for_overwrite< uint8_t[] >( kCopyBufferSize );
+
+                while ( length != 0 ) {
+                    const auto chunk = std::span( buffer_.get(), static_cast< size_t >( std::min< uint64_t >( kCopyBufferSize, length ) ) );
+                    if ( const auto read = source.read_at( offset, chunk ); !read )
+                        return unexpected( read.error() );
+
+                    if ( !write( chunk ) )
+                        return unexpected( "Failed to write the compacted package." );
+
+                    offset += chunk.size();
+                    length -= chunk.size();
+                }
+
+                return {};
+            }
+
+            /**
+             * @brief Hand buffered writes to the file, so other handles to it see them
+             */
+            bool flush() {
+#ifdef _WIN32
+                stream_.flush();
+                return stream_.good();
+#else
+                return true;
+#endif
+            }
+
+            /**
+             * @brief Flush the data to the disk, so the rename never exposes a partial file
+             */
+            bool finish() {
+#ifdef _WIN32
+                stream_.flush();
+                const bool flushed = stream_.good();
+                stream_.close();
+                return flushed;
+#else
+                const bool synced = ::fsync( fd_ ) == 0;
+                return ::close( std::exchange( fd_, -1 ) ) == 0 && synced;
+#endif
+            }
+
+        private:
+            void close() noexcept {
+#ifndef _WIN32
+                if ( fd_ >= 0 )
+                    ::close( std::exchange( fd_, -1 ) );
+#endif
+            }
+
+#ifdef _WIN32
+            std::ofstream stream_;
+#else
+            int fd_ = -1;
+#endif
+            bool buffered_only_ = false;
+            std::unique_ptr< uint8_t[] > buffer_;
+        };
+
+        /**
+         * @brief Path order that keeps every directory contiguous, its own files first and then its subdirectories
+         */
+        bool path_less( std::string_view lhs, std::string_view rhs ) {
+            const auto split = []( std::string_view path ) {
+                const auto separator = path.find_last_of( "\\/" );
+                return separator == std::string_view::npos ? std::pair( std::string_view {}, path )
+                                                           : std::pair( path.substr( 0, separator ), path.substr( separator + 1 ) );
+            };
+
+            // Separators rank below every other character, so `a\b` sorts right after `a` and before `a-b`
+            const auto rank = []( char c ) { return c == '\\' || c == '/' ? 0 : static_cast< unsigned char >( c ) + 1; };
+            const auto less = [ & ]( std::string_view a, std::string_view b ) {
+                return std::ranges::lexicographical_compare( a, b, {}, rank, rank );
+            };
+
+            const auto [ lhs_directory, lhs_name ] = split( lhs );
+            const auto [ rhs_directory, rhs_name ] = split( rhs );
+            if ( lhs_directory != rhs_directory )
+                return less( lhs_directory, rhs_directory );
+
+            return less( lhs_name, rhs_name );
+        }
+
+    } // namespace
+
+    expected< compact_report_t > compact_package( const std::shared_ptr< package >& package, const compact_options_t& options ) {
+        const auto& package_path = package->get_path();
+        const auto& files = package->get_files();
+
+        std::error_code ec;
+        const uint64_t old_size = std::filesystem::file_size( package_path, ec );
+        if ( ec || old_size < kMetadataSize ) {
+            return unexpected( "Failed to read the package file size." );
+        }
+
+        const uint64_t metadata_offset = old_size - kMetadataSize;
+
+        std::vector< uint32_t > order( files.size() );
+        std::iota( order.begin(), order.end(), uint32_t { 0 } );
+
+        if ( options.layout == compact_layout_t::kByPath ) {
+            std::ranges::stable_sort( order, [ & ]( uint32_t lhs, uint32_t rhs ) { return path_less( files.name( lhs ), files.name( rhs ) ); } );
+        }
+        else {
+            std::ranges::stable_sort( order, {}, [ & ]( uint32_t i ) { return files.offsets()[ i ]; } );
+        }
+
+        // Entries that continue or overlap the current run share it, anything else starts a new run at the output end
+        file_table compacted = files;
+        std::vector< copy_run_t > runs;
+        uint64_t run_end = 0;
+        uint64_t new_end = 0; // Compacted data before the current run
+
+        for ( const auto index : order ) {
+            const uint64_t offset = files.offsets()[ index ];
+            const uint64_t size = files.sizes()[ index ];
+
+            if ( size == 0 ) {
+                compacted.set_location( index, new_end + ( runs.empty() ? 0 : runs.back().length ), 0 );
+                continue;
+            }
+
+            if ( offset > metadata_offset || size > metadata_offset - offset ) {
+                return unexpected( "Entry data is out of the package bounds: " + std::string( files.name( index ) ) );
+            }
+
+            if ( runs.empty() || offset < runs.back().source || offset > run_end ) {
+                new_end += runs.empty() ? 0 : runs.back().length;
+                runs.push_back( { offset, size } );
+                run_end = offset + size;
+            }
+            else if ( offset + size > run_end ) {
+                runs.back().length += offset + size - run_end;
+                run_end = offset + size;
+            }
+
+            compacted.set_location( index, new_end + ( offset - runs.back().source ), size );
+        }
+
+        auto temp_path = package_path;
+        temp_path += ".compact.tmp";
+
+        const auto fail = [ & ]( std::string message ) -> expected< compact_report_t > {
+            std::error_code remove_ec;
+            std::filesystem::remove( temp_path, remove_ec );
+            return unexpected( std::move( message ) );
+        };
+
+        uint64_t new_size = 0;
+        std::optional< std::string > error;
+        {
+            const auto source = detail::file_handle::open( package_path );
+            if ( !source ) {
+                return unexpected( source.error() );
+            }
+
+            compact_output_t output;
+            if ( !output.open( temp_path ) ) {
+                return unexpected( "Failed to create the compacted package." );
+            }
+
+            source->advise( 0, 0, detail::access_hint_t::kSequential );
+
+            for ( const auto& run : runs ) {
+                if ( const auto copied = output.copy( *source, run.source, run.length ); !copied ) {
+                    error = copied.error();
+                    break;
+                }
+                new_size += run.length;
+            }
+
+            // Seal the output as base data, so `remove_patches` never takes anything in it for a patch
+            if ( !error ) {
+                const auto footer = detail::make_base_footer( new_size );
+                if ( !output.write( { reinterpret_cast< const uint8_t* >( &footer ), sizeof( footer ) } ) ) {
+                    error = "Failed to write the compacted package.";
+                }
+                new_size += sizeof( footer );
+            }
+
+            if ( !error && ( !output.write( detail::encode_metadata_slots( compacted ) ) || !output.flush() ) ) {
+                error = "Failed to write the compacted package.";
+            }
+
+            if ( !error ) {
+                if ( const auto tail = detail::append_metadata_tail( temp_path, new_size, options.share_metadata_tail ); !tail ) {
+                    error = tail.error();
+                }
+                else if ( !output.finish() ) {
+                    error = "Failed to write the compacted package.";
+                }
+                new_size += kMetadataSize;
+            }
+        } // Both files are closed before the temporary file is removed or renamed
+
+        if ( error ) {
+            return fail( std::move( *error ) );
+        }
+
+        std::filesystem::rename( temp_path, package_path, ec );
+        if ( ec ) {
+            return fail( "Failed to replace the package: " + ec.message() );
+        }
+
+        return compact_report_t { .old_size = old_size,
+                                  .new_size = new_size,
+                                  .reclaimed = old_size > new_size ? old_size - new_size : 0,
+                                  .runs = runs.size() };
+    }
+
+} // namespace kspkg
@@ -0,0 +1,79 @@
+#include <kspkg-core/content_cache.hpp>
+
+namespace kspkg {
+
+    shared_content_t content_cache::find( uint32_t key ) {
+        std::lock_guard lock( mutex_ );
+
+        const auto it = lookup_.find( key );
+        if ( it == lookup_.end() ) {
+            misses_++;
+            return nullptr;
+        }
+
+        hits_++;
+        items_.splice( items_.begin(), items_, it->second );
+        return it->second->content;
+    }
+
+    shared_content_t content_cache::insert( uint32_t key, shared_content_t content ) {
+        std::lock_guard lock( mutex_ );
+
+        if ( const auto it = lookup_.find( key ); it != lookup_.end() ) {
+            items_.splice( items_.begin(), items_, it->second );
+            return it->second->content;
+        }
+
+        if ( !content || content->size() > budget_ )
+            return content;
+
+        evict_to( budget_ - content->size() );
+
+        items_.push_front( { key, content } );
+        lookup_.emplace( key, items_.begin() );
+        bytes_ += content->size();
+
+        return content;
+    }
+
+    void content_cache::erase( uint32_t key ) {
+        std::lock_guard lock( mutex_ );
+
+        if ( const auto it = lookup_.find( key ); it != lookup_.end() ) {
+            bytes_ -= it->second->content->size();
+            items_.erase( it->second );
+            lookup_.erase( it );
+        }
+    }
+
+    void content_cache::clear() {
+        std::lock_guard lock( mutex_ );
+
+        items_.clear();
+        lookup_.clear();
+        bytes_ = 0;
+    }
+
+    void content_cache::set_budget( size_t budget ) {
+        std::lock_guard lock( mutex_ );
+
+        budget_ = budget;
+        evict_to( budget_ );
+    }
+
+    content_cache_stats_t content_cache::stats() const {
+        std::lock_guard lock( mutex_ );
+
+        return { hits_, misses_, evictions_, lookup_.size(), bytes_, budget_ };
+    }
+
+    void content_cache::evict_to( size_t budget ) {
+        while ( bytes_ > budget && !items_.empty() ) {
+            bytes_ -= items_.back().content->size();
+            lookup_.erase( items_.back().key );
+            items_.pop_back();
+            evictions_++;
+        }
+    }
+
+} // namespace kspkg
\ No newline at end of file
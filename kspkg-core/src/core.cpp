@@ -1,202 +1,560 @@
 #include <kspkg-core/core.hpp>
+#include <kspkg-core/cipher.hpp>
+#include <kspkg-core/patch_builder.hpp>
+
+#include "chunk_pipeline.hpp"
+#include "extract_plan.hpp"
+#include "hash.hpp"
+#include "io_uring_extract.hpp"
+#include "metadata.hpp"
+#include "patch_format.hpp"
+#include "sidecar.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <system_error>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <cerrno>
+    #include <unistd.h>
+#endif
 
 namespace kspkg {
-    constexpr size_t kXorKey = 0x9F9721A97D1135C1;
-    constexpr size_t kMetadataSize = 0x2000000;
+    namespace {
 
-    namespace detail {
-
-        inline void encrypt_decrypt_data( std::vector< uint8_t >& data, size_t key ) {
-            size_t i = 0;
+        void tally( extract_report_t& report ) {
+            for ( const auto& result : report.results ) {
+                if ( result.status ) {
+                    report.extracted += 1;
+                    report.bytes += result.entry.get_file_size();
+                }
+                else {
+                    report.failed += 1;
+                }
+            }
+        }
 
-            for ( ; i + sizeof( size_t ) <= data.size(); i += sizeof( size_t ) ) {
-                *reinterpret_cast< size_t* >( &data[ i ] ) ^= key;
+        expected< std::ofstream > create_output( const file& file, const std::filesystem::path& out_directory ) {
+            const auto out_path = detail::prepare_output_path( file, out_directory );
+            if ( !out_path ) {
+                return unexpected( out_path.error() );
             }
 
-            for ( ; i < data.size(); ++i ) {
-                data[ i ] ^= static_cast< uint8_t >( key );
-                key >>= 8;
+            std::ofstream output( *out_path, std::ios::binary );
+            if ( !output.is_open() ) {
+                return unexpected( "Failed to open the output file." );
             }
+
+            return output;
         }
 
-    } // namespace detail
+    } // namespace
 
-    expected< bool > package::extract_file( const std::shared_ptr< file >& file, const std::filesystem::path& out_directory ) {
-        stream_.seekg( static_cast< std::streamoff >( file->get_file_offset() ), std::ios::beg );
+    file package::find( std::string_view path ) const {
+        if ( const auto position = index_.find( files_, path ); position != detail::path_index::kNotFound ) {
+            return files_[ position ];
+        }
 
-        const std::filesystem::path out_path = std::filesystem::path( out_directory ) / file->get_name();
-        create_directories( std::filesystem::path( out_path ).parent_path() );
+        return {};
+    }
 
-        if ( file->is_directory() ) {
-            return unexpected( "Cannot extract a directory." );
+    void package::set_file_location( const file& file, uint64_t offset, uint64_t size ) {
+        files_.set_location( file.get_index(), offset, size );
+        cache_.erase( file.get_index() );
+    }
+
+    expected< std::span< const uint8_t > > package::mapped_range( const file& file ) const {
+        const auto data = mapping_.data();
+        if ( file.get_file_offset() > data.size() || file.get_file_size() > data.size() - file.get_file_offset() ) {
+            return unexpected( "File is out of the package bounds." );
         }
 
-        std::vector< uint8_t > data( file->get_file_size() );
-        stream_.read( reinterpret_cast< char* >( data.data() ), static_cast< std::streamsize >( file->get_file_size() ) );
+        return data.subspan( file.get_file_offset(), file.get_file_size() );
+    }
+
+    expected< bool > package::extract_file( const file& file, const std::filesystem::path& out_directory ) const {
+        if ( file.is_directory() ) {
+            return unexpected( "Cannot extract a directory." );
+        }
 
-        if ( file->is_encrypted() ) {
-            detail::encrypt_decrypt_data( data, kXorKey );
+        auto output = create_output( file, out_directory );
+        if ( !output ) {
+            return unexpected( output.error() );
         }
 
-        std::ofstream output( out_path, std::ios::binary );
-        output.write( reinterpret_cast< char* >( data.data() ), static_cast< std::streamsize >( file->get_file_size() ) );
+        if ( const auto extracted = extract_to( file, *output ); !extracted ) {
+            return unexpected( extracted.error() );
+        }
 
         return true;
     }
 
-    expected< std::vector< uint8_t > > package::extract_file( const std::shared_ptr< file >& file ) {
-        std::vector< uint8_t > result;
+    expected< void > package::extract_to( const file& file, const chunk_sink_t& sink, size_t chunk_size ) const {
+        if ( file.is_directory() ) {
+            return unexpected( "Cannot extract a directory." );
+        }
 
-        stream_.seekg( static_cast< std::streamoff >( file->get_file_offset() ), std::ios::beg );
+        const size_t file_size = file.get_file_size();
+        chunk_size = std::max< size_t >( chunk_size, 1 );
 
-        if ( file->is_directory() ) {
-            return unexpected( "Cannot extract a directory." );
+        if ( !is_mapped() && file_size >= detail::kPipelineThreshold ) {
+            // Huge entries overlap the disk read, the decryption and the sink on separate threads
+            const auto read = [ & ]( uint64_t position, std::span< uint8_t > chunk ) {
+                return handle_.read_at( file.get_file_offset() + position, chunk );
+            };
+            const auto decrypt = [ & ]( uint64_t position, std::span< uint8_t > chunk ) {
+                detail::encrypt_decrypt_data( chunk, detail::key_at_offset( kXorKey, position ) );
+            };
+
+            return detail::run_chunk_pipeline( file_size, chunk_size, read,
+                                               file.is_encrypted() ? detail::chunk_transform_t( decrypt ) : nullptr, sink );
         }
 
-        result.resize( file->get_file_size() );
-        stream_.read( reinterpret_cast< char* >( result.data() ), static_cast< std::streamsize >( file->get_file_size() ) );
+        std::span< const uint8_t > mapped;
+        if ( is_mapped() ) {
+            const auto range = mapped_range( file );
+            if ( !range ) {
+                return unexpected( range.error() );
+            }
+            mapped = *range;
+        }
 
-        if ( file->is_encrypted() ) {
-            detail::encrypt_decrypt_data( result, kXorKey );
+        std::vector< uint8_t > buffer;
+        if ( !is_mapped() || file.is_encrypted() ) {
+            buffer.resize( std::min( chunk_size, file_size ) );
         }
 
-        return result;
+        for ( size_t done = 0; done < file_size; ) {
+            const size_t length = std::min( chunk_size, file_size - done );
+
+            std::span< const uint8_t > chunk;
+            if ( is_mapped() && !file.is_encrypted() ) {
+                // Unencrypted chunks are handed out straight from the mapping
+                chunk = mapped.subspan( done, length );
+            }
+            else {
+                const auto target = std::span( buffer ).first( length );
+                if ( is_mapped() ) {
+                    std::ranges::copy( mapped.subspan( done, length ), target.begin() );
+                }
+                else if ( const auto read = handle_.read_at( file.get_file_offset() + done, target ); !read ) {
+                    return unexpected( read.error() );
+                }
+
+                if ( file.is_encrypted() ) {
+                    // Keep the key phase aligned with the position inside the file
+                    detail::encrypt_decrypt_data( target, detail::key_at_offset( kXorKey, done ) );
+                }
+                chunk = target;
+            }
+
+            if ( const auto written = sink( chunk ); !written ) {
+                return unexpected( written.error() );
+            }
+            done += length;
+        }
+
+        return {};
     }
 
-    expected< std::shared_ptr< package > > load_package( const std::filesystem::path& path ) {
-        std::ifstream fs( path, std::ios::binary );
-        if ( !fs.is_open() )
-            return unexpected( "Failed to open the package file for reading." );
+    expected< void > package::extract_to( const file& file, std::ostream& output, size_t chunk_size ) const {
+        return extract_to(
+            file,
+            [ &output ]( std::span< const uint8_t > chunk ) -> expected< void > {
+                output.write( reinterpret_cast< const char* >( chunk.data() ), static_cast< std::streamsize >( chunk.size() ) );
+                if ( !output ) {
+                    return unexpected( "Failed to write the output file." );
+                }
+                return {};
+            },
+            chunk_size );
+    }
+
+    expected< void > package::extract_to( const file& file, int fd, size_t chunk_size ) const {
+        return extract_to(
+            file,
+            [ fd ]( std::span< const uint8_t > chunk ) -> expected< void > {
+                while ( !chunk.empty() ) {
+#ifdef _WIN32
+                    const auto to_write = static_cast< unsigned int >( std::min< size_t >( chunk.size(), 0x40000000 ) );
+                    const int written = _write( fd, chunk.data(), to_write );
+#else
+                    const ssize_t written = write( fd, chunk.data(), chunk.size() );
+                    if ( written < 0 && errno == EINTR )
+                        continue;
+#endif
+                    if ( written <= 0 ) {
+                        return unexpected( "Failed to write to the file descriptor." );
+                    }
+                    chunk = chunk.subspan( static_cast< size_t >( written ) );
+                }
+                return {};
+            },
+            chunk_size );
+    }
+
+    extract_report_t package::extract_many( const std::vector< file >& files, const std::filesystem::path& out_directory,
+                                            const extract_options_t& options ) const {
+        extract_report_t report;
+        report.results.resize( files.size() );
+
+        // Visit requests in package order so reads only move forward through the file
+        const auto order = detail::offset_order( files );
+        const auto runs = detail::plan_runs( files, order );
+
+        const auto advise = [ & ]( uint64_t offset, uint64_t length, detail::access_hint_t hint ) {
+            if ( is_mapped() )
+                mapping_.advise( offset, length, hint );
+            else
+                handle_.advise( offset, length, hint );
+        };
+
+        // Read ahead sequentially for the batch only, the package outlives it and later reads are random again
+        advise( 0, 0, detail::access_hint_t::kSequential );
+
+        // The ring reads through the file descriptor, mapped packages stay on the threads
+        if ( options.backend == extract_backend_t::kIoUring && !is_mapped() && detail::is_io_uring_available() &&
+             detail::extract_with_io_uring( handle_, files, order, runs, out_directory, options.queue_depth, report.results ) ) {
+            advise( 0, 0, detail::access_hint_t::kNormal );
+            report.backend = extract_backend_t::kIoUring;
+            tally( report );
+            return report;
+        }
+
+        const auto extract_entry = [ & ]( size_t k, const std::function< expected< void >( const file& ) >& extract ) {
+            auto& result = report.results[ order[ k ] ];
+            result.entry = files[ order[ k ] ];
+
+            try {
+                result.status = extract( result.entry );
+            }
+            catch ( const std::exception& e ) {
+                result.status = unexpected( e.what() );
+            }
+        };
+
+        const auto extract_streamed = [ & ]( const file& file ) -> expected< void > {
+            if ( const auto extracted = extract_file( file, out_directory ); !extracted ) {
+                return unexpected( extracted.error() );
+            }
+            return {};
+        };
 
-        fs.seekg( -static_cast< std::streamoff >( kMetadataSize ), std::ios::end );
+        detail::work_stealing_pool pool( options.concurrency );
+        pool.parallel_for( runs.size(), [ & ]( size_t r ) {
+            const auto& run = runs[ r ];
 
-        std::vector< uint8_t > metadata_buffer( kMetadataSize );
-        fs.read( reinterpret_cast< char* >( metadata_buffer.data() ), kMetadataSize );
-        detail::encrypt_decrypt_data( metadata_buffer, kXorKey );
+            // Workers walk their runs in offset order, let the OS fetch the next one while this one is written
+            if ( r + 1 < runs.size() )
+                advise( runs[ r + 1 ].offset, runs[ r + 1 ].size, detail::access_hint_t::kWillNeed );
 
-        std::vector< std::shared_ptr< file > > files;
+            std::span< const uint8_t > data;
+            std::unique_ptr< uint8_t[] > buffer;
 
-        constexpr auto max_count = kMetadataSize / sizeof( file_desc_t );
-        for ( size_t i = 0; i < max_count; i++ ) {
-            if ( const auto& file_desc = *reinterpret_cast< file_desc_t* >( metadata_buffer.data() + i * sizeof( file_desc_t ) );
-                 file_desc.file_hash != 0 ) {
-                files.emplace_back( std::make_shared< file >( file_desc ) );
+            if ( !run.streamed && is_mapped() && run.offset <= mapping_.size() && run.size <= mapping_.size() - run.offset ) {
+                data = mapping_.data().subspan( run.offset, run.size );
             }
+            else if ( !run.streamed && !is_mapped() ) {
+                // A throw here would end the process from the worker, a run that cannot be buffered goes entry by entry instead
+                try {
+                    buffer = std::make_unique_for_overwrite< uint8_t[] >( run.size );
+                    if ( handle_.read_at( run.offset, { buffer.get(), run.size } ) )
+                        data = { buffer.get(), run.size };
+                }
+                catch ( const std::exception& ) {
+                    buffer.reset();
+                }
+            }
+
+            if ( run.streamed || ( data.empty() && run.size != 0 ) ) {
+                // Streamed entries, and runs that failed to buffer or read, go entry by entry so each one reports its own error
+                for ( size_t k = run.begin; k < run.end; k++ ) {
+                    extract_entry( k, extract_streamed );
+                }
+                return;
+            }
+
+            std::vector< uint8_t > decrypted;
+            for ( size_t k = run.begin; k < run.end; k++ ) {
+                extract_entry( k, [ & ]( const file& file ) -> expected< void > {
+                    auto contents = data.subspan( file.get_file_offset() - run.offset, file.get_file_size() );
+
+                    if ( file.is_encrypted() ) {
+                        decrypted.assign( contents.begin(), contents.end() );
+                        detail::encrypt_decrypt_data( decrypted, kXorKey );
+                        contents = decrypted;
+                    }
+
+                    auto output = create_output( file, out_directory );
+                    if ( !output )
+                        return unexpected( output.error() );
+
+                    output->write( reinterpret_cast< const char* >( contents.data() ), static_cast< std::streamsize >( contents.size() ) );
+                    if ( !output->good() )
+                        return unexpected( "Failed to write the output file." );
+
+                    return {};
+                } );
+            }
+        } );
+
+        advise( 0, 0, detail::access_hint_t::kNormal );
+        tally( report );
+        return report;
+    }
+
+    extract_report_t package::extract_all( const std::filesystem::path& out_directory, const extract_options_t& options ) const {
+        std::vector< file > entries;
+        std::ranges::copy_if( files_, std::back_inserter( entries ), []( const file& file ) { return !file.is_directory(); } );
+
+        return extract_many( entries, out_directory, options );
+    }
+
+    expected< std::vector< uint8_t > > package::extract_file( const file& file ) const {
+        std::vector< uint8_t > result;
+
+        if ( const auto read = read_file( file, result ); !read ) {
+            return unexpected( read.error() );
         }
 
-        return std::make_shared< package >( std::move( fs ), path, files );
+        return result;
     }
 
-    expected< void > repack_package( const std::shared_ptr< package >& package, const std::vector< std::filesystem::path >& new_filespathes,
-                                     const std::filesystem::path& new_files_root_dir ) {
-        std::ofstream fs( package->get_path(), std::ios::binary | std::ios::app );
-        if ( !fs.is_open() )
-            return unexpected( "Failed to open the package file for writing." );
+    expected< std::span< uint8_t > > package::extract_into( const file& file, std::span< uint8_t > buffer ) const {
+        if ( file.is_directory() ) {
+            return unexpected( "Cannot extract a directory." );
+        }
 
-        const auto& files = package->get_files();
+        if ( buffer.size() < file.get_file_size() ) {
+            return unexpected( "Buffer is too small for the file." );
+        }
+
+        const auto target = buffer.first( file.get_file_size() );
+
+        if ( is_mapped() ) {
+            const auto range = mapped_range( file );
+            if ( !range ) {
+                return unexpected( range.error() );
+            }
+            std::ranges::copy( *range, target.begin() );
+        }
+        else if ( const auto read = handle_.read_at( file.get_file_offset(), target ); !read ) {
+            return unexpected( read.error() );
+        }
+
+        if ( file.is_encrypted() ) {
+            detail::encrypt_decrypt_data( target, kXorKey );
+        }
 
-        // Write `marker` to find it when removing patch
-        const std::vector< uint8_t > marker = { 0x31, 0x32, 0x33, 0x34, 0x35 };
-        fs.write( reinterpret_cast< const char* >( marker.data() ), static_cast< std::streamsize >( marker.size() ) );
+        return target;
+    }
 
-        for ( const auto& new_filepath : new_filespathes ) {
-            std::ifstream file( new_filepath, std::ios::binary );
-            if ( !file.is_open() )
-                continue;
+    expected< std::span< uint8_t > > package::extract_into( const file& file, std::pmr::vector< uint8_t >& buffer ) const {
+        // Growing is the only time the buffer is allocated and zeroed, smaller files reuse it as is
+        if ( !file.is_directory() && buffer.size() < file.get_file_size() ) {
+            buffer.resize( file.get_file_size() );
+        }
 
-            file.seekg( 0, std::ios::end );
-            const auto file_size = file.tellg();
-            file.seekg( 0, std::ios::beg );
+        return extract_into( file, std::span( buffer ) );
+    }
 
-            std::vector< uint8_t > new_data( file_size );
-            file.read( reinterpret_cast< char* >( new_data.data() ), file_size );
+    expected< size_t > package::read_range( const file& file, uint64_t offset, std::span< uint8_t > buffer ) const {
+        if ( file.is_directory() ) {
+            return unexpected( "Cannot extract a directory." );
+        }
 
-            fs.seekp( 0, std::ios::end );
-            const auto offset = fs.tellp();
-            fs.seekp( 0, std::ios::beg );
+        const uint64_t file_size = file.get_file_size();
+        if ( offset >= file_size ) {
+            return size_t { 0 };
+        }
 
-            const auto virtual_full_filename = new_files_root_dir / new_filepath.filename().string();
+        const auto target = buffer.first( static_cast< size_t >( std::min< uint64_t >( buffer.size(), file_size - offset ) ) );
 
-            // Find file in package and overwrite its desc
-            for ( auto&& loaded_file : files ) {
-                if ( loaded_file->get_name() == virtual_full_filename ) {
-                    if ( loaded_file->is_encrypted() ) {
-                        detail::encrypt_decrypt_data( new_data, kXorKey );
-                    }
-                    auto& desc = loaded_file->desc();
-                    desc.file_size = file_size;
-                    desc.file_offset = offset;
-                    fs.write( reinterpret_cast< const char* >( new_data.data() ), static_cast< std::streamsize >( new_data.size() ) );
-                    break;
-                }
+        if ( is_mapped() ) {
+            const auto range = mapped_range( file );
+            if ( !range ) {
+                return unexpected( range.error() );
             }
+            std::ranges::copy( range->subspan( offset, target.size() ), target.begin() );
+        }
+        else if ( const auto read = handle_.read_at( file.get_file_offset() + offset, target ); !read ) {
+            return unexpected( read.error() );
         }
 
-        // Just push metadata to the end of the file without care about old metadata
-        std::vector< uint8_t > metadata( kMetadataSize );
-        for ( size_t i = 0; i < files.size(); i++ ) {
-            const auto& file = files[ i ];
-            auto* desc = reinterpret_cast< file_desc_t* >( metadata.data() + i * sizeof( file_desc_t ) );
-            *desc = file->desc();
+        if ( file.is_encrypted() ) {
+            // The range may start anywhere inside an 8-byte key period
+            detail::encrypt_decrypt_data( target, detail::key_at_offset( kXorKey, offset ) );
         }
 
-        detail::encrypt_decrypt_data( metadata, kXorKey );
+        return target.size();
+    }
 
-        fs.write( reinterpret_cast< const char* >( metadata.data() ), static_cast< std::streamsize >( metadata.size() ) );
+    expected< shared_content_t > package::extract_cached( const file& file ) const {
+        if ( auto cached = cache_.find( file.get_index() ) )
+            return cached;
 
-        return {};
+        auto content = extract_file( file );
+        if ( !content )
+            return unexpected( content.error() );
+
+        return cache_.insert( file.get_index(), std::make_shared< const std::vector< uint8_t > >( std::move( *content ) ) );
     }
 
-    expected< bool > remove_patches( const std::shared_ptr< package >& package ) {
-        const std::vector< uint8_t > marker = { 0x31, 0x32, 0x33, 0x34, 0x35 };
-        const auto& package_path = package->get_path();
+    expected< std::span< const uint8_t > > package::view_file( const file& file, std::vector< uint8_t >& buffer ) const {
+        if ( is_mapped() && !file.is_encrypted() && !file.is_directory() ) {
+            // Unencrypted files are served straight from the mapping
+            return mapped_range( file );
+        }
 
-        std::ifstream fs_in( package_path, std::ios::binary );
-        if ( !fs_in.is_open() ) {
-            return unexpected( "Failed to open the package file for reading." );
+        if ( const auto read = read_file( file, buffer ); !read ) {
+            return unexpected( read.error() );
         }
 
-        // Define chunk size for reading in reverse
-        constexpr size_t chunk_size = 0x10000000; // 256 MB
-        std::vector< uint8_t > buffer( chunk_size );
+        return std::span< const uint8_t >( buffer );
+    }
 
-        fs_in.seekg( 0, std::ios::end );
-        const auto file_size = fs_in.tellg();
+    expected< void > package::read_file( const file& file, std::vector< uint8_t >& buffer ) const {
+        if ( file.is_directory() ) {
+            return unexpected( "Cannot extract a directory." );
+        }
 
-        size_t read_position = file_size;
-        size_t marker_position = std::string::npos;
+        if ( is_mapped() ) {
+            const auto range = mapped_range( file );
+            if ( !range ) {
+                return unexpected( range.error() );
+            }
+            buffer.assign( range->begin(), range->end() );
+        }
+        else {
+            buffer.resize( file.get_file_size() );
+            if ( const auto read = handle_.read_at( file.get_file_offset(), buffer ); !read ) {
+                return unexpected( read.error() );
+            }
+        }
 
-        while ( read_position > 0 ) {
-            const size_t read_amount = std::min( chunk_size, read_position );
-            read_position -= read_amount;
+        if ( file.is_encrypted() ) {
+            detail::encrypt_decrypt_data( buffer, kXorKey );
+        }
+
+        return {};
+    }
 
-            fs_in.seekg( static_cast< std::streamoff >( read_position ), std::ios::beg );
-            fs_in.read( reinterpret_cast< char* >( buffer.data() ), static_cast< std::streamsize >( read_amount ) );
+    expected< std::shared_ptr< package > > load_package( const std::filesystem::path& path, const load_options_t& options ) {
+        detail::file_handle handle;
+        detail::mapped_file mapping;
+        uint64_t package_size = 0;
 
-            if ( auto it = std::search( buffer.rbegin(), buffer.rend(), marker.rbegin(), marker.rend() ); it != buffer.rend() ) {
-                marker_position = read_position + ( buffer.rend() - it - marker.size() );
-                break;
+        if ( options.memory_map ) {
+            auto mapped = detail::mapped_file::open( path );
+            if ( !mapped )
+                return unexpected( "Failed to map the package file for reading." );
+
+            mapping = std::move( *mapped );
+            package_size = mapping.size();
+        }
+        else {
+            auto opened = detail::file_handle::open( path );
+            if ( !opened )
+                return unexpected( "Failed to open the package file for reading." );
+
+            handle = std::move( *opened );
+            const auto size = handle.size();
+            if ( !size )
+                return unexpected( "Failed to read the package file size." );
+
+            package_size = *size;
+        }
+
+        if ( package_size < kMetadataSize )
+            return unexpected( "Package file is too small." );
+
+        const auto metadata_offset = package_size - kMetadataSize;
+        const auto make_package = [ & ]( file_table files, detail::path_index index ) {
+            std::shared_ptr< package > result;
+            if ( options.memory_map )
+                result = std::make_shared< package >( std::move( mapping ), path, std::move( files ), std::move( index ) );
+            else
+                result = std::make_shared< package >( std::move( handle ), path, std::move( files ), std::move( index ) );
+
+            result->set_cache_budget( options.cache_budget );
+            return result;
+        };
+
+        std::optional< detail::sidecar_key_t > sidecar_key;
+        if ( options.sidecar_index ) {
+            std::error_code ec;
+            const auto mtime = std::filesystem::last_write_time( path, ec );
+
+            const auto metadata_hash = options.memory_map
+                                           ? detail::hash_metadata( mapping.data().subspan( metadata_offset ), options.concurrency )
+                                           : detail::hash_metadata( handle, metadata_offset, options.concurrency );
+
+            if ( !ec && metadata_hash ) {
+                sidecar_key = { package_size, mtime.time_since_epoch().count(), *metadata_hash };
+
+                file_table files;
+                detail::path_index index;
+                if ( detail::read_sidecar( path, *sidecar_key, options.case_insensitive_lookup, files, index ) )
+                    return make_package( std::move( files ), std::move( index ) );
             }
+        }
 
-            // TODO: Make smarter system
-            // Drop search when marker is not found in the first chunk (256 MB)
-            break;
+        file_table files;
+        if ( options.memory_map ) {
+            files = detail::decode_metadata( mapping.data().subspan( metadata_offset ), options.concurrency );
         }
+        else {
+            auto decoded = detail::decode_metadata( handle, metadata_offset, options.concurrency );
+            if ( !decoded )
+                return unexpected( decoded.error() );
 
-        fs_in.close();
+            files = std::move( *decoded );
+        }
 
-        if ( marker_position == std::string::npos ) {
-            return false;
+        detail::path_index index( files, options.case_insensitive_lookup );
+
+        // The sidecar is only a cache, the package opens fine when it cannot be written
+        if ( sidecar_key )
+            detail::write_sidecar( path, *sidecar_key, files, index );
+
+        return make_package( std::move( files ), std::move( index ) );
+    }
+
+    expected< void > repack_package( const std::shared_ptr< package >& package, const std::vector< std::filesystem::path >& new_filespathes,
+                                     const std::filesystem::path& new_files_root_dir, const patch_options_t& options ) {
+        patch_builder builder( package );
+        builder.stage( new_filespathes, new_files_root_dir );
+
+        return builder.commit( options );
+    }
+
+    expected< bool > remove_patches( const std::shared_ptr< package >& package ) {
+        const auto& package_path = package->get_path();
+
+        std::error_code ec;
+        const uint64_t file_size = std::filesystem::file_size( package_path, ec );
+        if ( ec ) {
+            return unexpected( "Failed to read the package file size." );
         }
 
-        std::ofstream fs_out( package_path, std::ios::binary | std::ios::in );
-        if ( !fs_out.is_open() ) {
-            return unexpected( "Failed to open the package file for writing." );
+        // Only the newest patch is removed, its footer tells where it starts
+        const auto patch_position = detail::find_newest_patch( package_path, file_size );
+        if ( !patch_position ) {
+            return unexpected( patch_position.error() );
         }
-        fs_out.seekp( static_cast< std::streamoff >( marker_position ), std::ios::beg );
-        fs_out.close();
 
-        resize_file( package_path, marker_position );
+        if ( !*patch_position ) {
+            return false;
+        }
+
+        resize_file( package_path, **patch_position, ec );
+        if ( ec ) {
+            return unexpected( "Failed to truncate the package file: " + ec.message() );
+        }
 
         return true;
     }
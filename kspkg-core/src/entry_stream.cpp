@@ -0,0 +1,112 @@
+#include <kspkg-core/entry_stream.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace kspkg {
+
+    entry_streambuf::entry_streambuf( std::shared_ptr< const package > package, file file, size_t buffer_size )
+        : package_( std::move( package ) ), file_( file ), buffer_( std::max< size_t >( buffer_size, 1 ) ) {
+        reset_to( 0 );
+    }
+
+    uint64_t entry_streambuf::position() const noexcept {
+        return buffer_position_ + static_cast< uint64_t >( gptr() - eback() );
+    }
+
+    void entry_streambuf::reset_to( uint64_t position ) noexcept {
+        buffer_position_ = position;
+        setg( buffer_.data(), buffer_.data(), buffer_.data() );
+    }
+
+    size_t entry_streambuf::read( uint64_t position, char_type* data, size_t count ) {
+        const auto read = package_->read_range( file_, position, { reinterpret_cast< uint8_t* >( data ), count } );
+        if ( !read ) {
+            error_ = read.error();
+            return 0;
+        }
+
+        return *read;
+    }
+
+    entry_streambuf::int_type entry_streambuf::underflow() {
+        if ( gptr() < egptr() )
+            return traits_type::to_int_type( *gptr() );
+
+        const uint64_t next = position();
+        const size_t length = read( next, buffer_.data(), buffer_.size() );
+
+        buffer_position_ = next;
+        setg( buffer_.data(), buffer_.data(), buffer_.data() + length );
+
+        return length ? traits_type::to_int_type( *gptr() ) : traits_type::eof();
+    }
+
+    std::streamsize entry_streambuf::xsgetn( char_type* data, std::streamsize count ) {
+        std::streamsize done = 0;
+
+        while ( done < count ) {
+            const auto buffered = std::min< std::streamsize >( egptr() - gptr(), count - done );
+            if ( buffered > 0 ) {
+                std::memcpy( data + done, gptr(), static_cast< size_t >( buffered ) );
+                gbump( static_cast< int >( buffered ) );
+                done += buffered;
+                continue;
+            }
+
+            const auto remaining = static_cast< size_t >( count - done );
+            if ( remaining >= buffer_.size() ) {
+                // Large reads skip the buffer and land in the caller's memory directly
+                const uint64_t next = position();
+                const size_t length = read( next, data + done, remaining );
+                if ( length == 0 )
+                    break;
+
+                reset_to( next + length );
+                done += static_cast< std::streamsize >( length );
+                continue;
+            }
+
+            if ( traits_type::eq_int_type( underflow(), traits_type::eof() ) )
+                break;
+        }
+
+        return done;
+    }
+
+    std::streamsize entry_streambuf::showmanyc() {
+        const uint64_t file_size = file_.get_file_size();
+        const uint64_t next = position();
+
+        return next < file_size ? static_cast< std::streamsize >( file_size - next ) : -1;
+    }
+
+    entry_streambuf::pos_type entry_streambuf::seekoff( off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which ) {
+        if ( !( which & std::ios_base::in ) )
+            return pos_type( off_type( -1 ) );
+
+        off_type base = 0;
+        if ( direction == std::ios_base::cur )
+            base = static_cast< off_type >( position() );
+        else if ( direction == std::ios_base::end )
+            base = static_cast< off_type >( file_.get_file_size() );
+
+        const off_type target = base + offset;
+        if ( target < 0 || static_cast< uint64_t >( target ) > file_.get_file_size() )
+            return pos_type( off_type( -1 ) );
+
+        // Seeks that land inside the buffered range keep the buffer
+        const uint64_t buffered_end = buffer_position_ + static_cast< uint64_t >( egptr() - eback() );
+        if ( static_cast< uint64_t >( target ) >= buffer_position_ && static_cast< uint64_t >( target ) <= buffered_end )
+            setg( eback(), eback() + ( static_cast< uint64_t >( target ) - buffer_position_ ), egptr() );
+        else
+            reset_to( static_cast< uint64_t >( target ) );
+
+        return pos_type( target );
+    }
+
+    entry_streambuf::pos_type entry_streambuf::seekpos( pos_type position, std::ios_base::openmode which ) {
+        return seekoff( off_type( position ), std::ios_base::beg, which );
+    }
+
+} // namespace kspkg
@@ -0,0 +1,87 @@
+#include "extract_plan.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace kspkg::detail {
+
+    std::vector< size_t > offset_order( const std::vector< file >& files ) {
+        std::vector< size_t > order( files.size() );
+        std::iota( order.begin(), order.end(), size_t { 0 } );
+        std::ranges::stable_sort( order, {}, [ & ]( size_t i ) { return files[ i ].get_file_offset(); } );
+
+        return order;
+    }
+
+    std::vector< read_run_t > plan_runs( const std::vector< file >& files, std::span< const size_t > order ) {
+        std::vector< read_run_t > runs;
+
+        for ( size_t k = 0; k < order.size(); k++ ) {
+            const auto& entry = files[ order[ k ] ];
+            const uint64_t offset = entry.get_file_offset();
+            const uint64_t end = offset + entry.get_file_size();
+            const bool streamed = entry.is_directory() || entry.get_file_size() > kMaxRunSize;
+
+            if ( !streamed && !runs.empty() && !runs.back().streamed ) {
+                auto& run = runs.back();
+                const uint64_t run_end = run.offset + run.size;
+
+                // Overlapping entries, e.g. the same file requested twice, start a run of their own
+                if ( offset >= run_end && offset <= run_end + kCoalesceGap && end - run.offset <= kMaxRunSize ) {
+                    run.size = end - run.offset;
+                    run.end = k + 1;
+                    continue;
+                }
+            }
+
+            runs.push_back( { k, k + 1, offset, entry.get_file_size(), streamed } );
+        }
+
+        return runs;
+    }
+
+    expected< std::filesystem::path > prepare_output_path( const file& file, const std::filesystem::path& out_directory ) {
+        // Package names come from the file, they are rebuilt one component at a time so they cannot leave the output
+        // directory. Both separators split, empty and `.` components (a leading separator too) are dropped
+        const std::string_view name = file.get_name();
+        std::filesystem::path relative_path;
+
+        for ( size_t begin = 0; begin <= name.size(); ) {
+            const size_t end = std::min( name.find_first_of( "\\/", begin ), name.size() );
+            const auto component = name.substr( begin, end - begin );
+            begin = end + 1;
+
+            if ( component.empty() || component == "." )
+                continue;
+
+#ifdef _WIN32
+            // `C:` or `C:name` would replace or prefix the drive of the output directory
+            if ( component.find( ':' ) != std::string_view::npos )
+                return unexpected( "Entry name leaves the output directory: " + std::string( name ) );
+#endif
+            if ( component == ".." )
+                return unexpected( "Entry name leaves the output directory: " + std::string( name ) );
+
+            relative_path /= component;
+        }
+
+        if ( relative_path.empty() ) {
+            return unexpected( "Entry name has no file name: " + std::string( name ) );
+        }
+
+        const std::filesystem::path out_path = out_directory / relative_path;
+
+        // Non-throwing overload, this also runs on extraction workers
+        std::error_code ec;
+        create_directories( out_path.parent_path(), ec );
+        if ( ec ) {
+            return unexpected( "Failed to create the output directory: " + ec.message() );
+        }
+
+        return out_path;
+    }
+
+} // namespace kspkg::detail
\ No newline at end of file
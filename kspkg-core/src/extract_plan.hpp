@@ -0,0 +1,44 @@
+#pragma once
+
+#include <kspkg-core/core.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace kspkg::detail {
+
+    constexpr uint64_t kCoalesceGap = 0x10000; // Holes up to 64 KB are read through instead of starting a new read
+    constexpr uint64_t kMaxRunSize = 0x800000; // 8 MB, larger entries are streamed on their own
+
+    /**
+     * @brief Requested entries fetched with one sequential read
+     */
+    struct read_run_t {
+        size_t begin = 0; // Range in the offset-sorted request order
+        size_t end = 0;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        bool streamed = false; // Single entry that is a directory or larger than `kMaxRunSize`
+    };
+
+    /**
+     * @brief Request positions sorted by package offset, requests at the same offset keep their order
+     */
+    std::vector< size_t > offset_order( const std::vector< file >& files );
+
+    /**
+     * @brief Coalesce offset-sorted requests into runs, entries inside one run never overlap
+     */
+    std::vector< read_run_t > plan_runs( const std::vector< file >& files, std::span< const size_t > order );
+
+    /**
+     * @brief Output path of an entry, its parent directories are created
+     *
+     * Leading separators and `.` components are dropped. Names with `..` components, or a drive on Windows, fail instead of
+     * escaping `out_directory`.
+     */
+    expected< std::filesystem::path > prepare_output_path( const file& file, const std::filesystem::path& out_directory );
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <kspkg-core/file_handle.hpp>
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace kspkg::detail {
+
+    file_handle::~file_handle() {
+        close();
+    }
+
+#ifdef _WIN32
+    file_handle::file_handle( file_handle&& other ) noexcept : handle_( std::exchange( other.handle_, nullptr ) ) { }
+
+    file_handle& file_handle::operator=( file_handle&& other ) noexcept {
+        if ( this != &other ) {
+            close();
+            handle_ = std::exchange( other.handle_, nullptr );
+        }
+        return *this;
+    }
+
+    std::expected< file_handle, std::string > file_handle::open( const std::filesystem::path& path ) {
+        // Share write/delete access so the package can still be patched while it is open
+        const HANDLE handle = CreateFileW( path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+        if ( handle == INVALID_HANDLE_VALUE )
+            return std::unexpected( "Failed to open the file for reading." );
+
+        file_handle result;
+        result.handle_ = handle;
+        return result;
+    }
+
+    bool file_handle::is_open() const noexcept {
+        return handle_ != nullptr;
+    }
+
+    std::expected< uint64_t, std::string > file_handle::size() const {
+        LARGE_INTEGER file_size {};
+        if ( !GetFileSizeEx( handle_, &file_size ) )
+            return std::unexpected( "Failed to query the file size." );
+
+        return static_cast< uint64_t >( file_size.QuadPart );
+    }
+
+    std::expected< void, std::string > file_handle::read_at( uint64_t offset, std::span< uint8_t > buffer ) const {
+        while ( !buffer.empty() ) {
+            // OVERLAPPED carries the offset, so the handle's own file pointer is never relied upon
+            OVERLAPPED overlapped {};
+            overlapped.Offset = static_cast< DWORD >( offset );
+            overlapped.OffsetHigh = static_cast< DWORD >( offset >> 32 );
+
+            const auto to_read = static_cast< DWORD >( std::min< size_t >( buffer.size(), 0x40000000 ) );
+            DWORD read = 0;
+            if ( !ReadFile( handle_, buffer.data(), to_read, &read, &overlapped ) || read == 0 )
+                return std::unexpected( "Failed to read from the file." );
+
+            offset += read;
+            buffer = buffer.subspan( read );
+        }
+
+        return {};
+    }
+
+    void file_handle::advise( uint64_t, uint64_t, access_hint_t ) const noexcept {
+        // Windows only takes access hints when the file is opened (FILE_FLAG_SEQUENTIAL_SCAN)
+    }
+
+    void file_handle::close() noexcept {
+        if ( handle_ )
+            CloseHandle( handle_ );
+
+        handle_ = nullptr;
+    }
+#else
+    file_handle::file_handle( file_handle&& other ) noexcept : fd_( std::exchange( other.fd_, -1 ) ) { }
+
+    file_handle& file_handle::operator=( file_handle&& other ) noexcept {
+        if ( this != &other ) {
+            close();
+            fd_ = std::exchange( other.fd_, -1 );
+        }
+        return *this;
+    }
+
+    std::expected< file_handle, std::string > file_handle::open( const std::filesystem::path& path ) {
+        const int fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+        if ( fd < 0 )
+            return std::unexpected( "Failed to open the file for reading." );
+
+        file_handle result;
+        result.fd_ = fd;
+        return result;
+    }
+
+    bool file_handle::is_open() const noexcept {
+        return fd_ >= 0;
+    }
+
+    std::expected< uint64_t, std::string > file_handle::size() const {
+        struct stat st {};
+        if ( fstat( fd_, &st ) != 0 )
+            return std::unexpected( "Failed to query the file size." );
+
+        return static_cast< uint64_t >( st.st_size );
+    }
+
+    std::expected< void, std::string > file_handle::read_at( uint64_t offset, std::span< uint8_t > buffer ) const {
+        while ( !buffer.empty() ) {
+            const ssize_t read = pread( fd_, buffer.data(), buffer.size(), static_cast< off_t >( offset ) );
+            if ( read < 0 && errno == EINTR )
+                continue;
+            if ( read <= 0 )
+                return std::unexpected( "Failed to read from the file." );
+
+            offset += static_cast< uint64_t >( read );
+            buffer = buffer.subspan( static_cast< size_t >( read ) );
+        }
+
+        return {};
+    }
+
+    void file_handle::advise( uint64_t offset, uint64_t length, access_hint_t hint ) const noexcept {
+    #ifdef POSIX_FADV_SEQUENTIAL
+        const int advice = hint == access_hint_t::kSequential ? POSIX_FADV_SEQUENTIAL
+                           : hint == access_hint_t::kWillNeed  ? POSIX_FADV_WILLNEED
+                                                               : POSIX_FADV_NORMAL;
+        posix_fadvise( fd_, static_cast< off_t >( offset ), static_cast< off_t >( length ), advice );
+    #else
+        ( void )offset;
+        ( void )length;
+        ( void )hint;
+    #endif
+    }
+
+    void file_handle::close() noexcept {
+        if ( fd_ >= 0 )
+            ::close( fd_ );
+
+        fd_ = -1;
+    }
+#endif
+
+} // namespace kspkg::detail
\ No newline at end of file
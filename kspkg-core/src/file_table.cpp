@@ -0,0 +1,111 @@
+#include <kspkg-core/file_table.hpp>
+
+#include "serialization.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace kspkg {
+
+    void file_table::reserve( size_t count ) {
+        offsets_.reserve( count );
+        sizes_.reserve( count );
+        hashes_.reserve( count );
+        name_offsets_.reserve( count );
+        name_lengths_.reserve( count );
+        flags_.reserve( count );
+        reserved_.reserve( count );
+    }
+
+    void file_table::push_back( const file_desc_t& desc ) {
+        const auto name_length = std::min< size_t >( desc.name_length, sizeof( desc.name ) );
+
+        offsets_.push_back( desc.file_offset );
+        sizes_.push_back( desc.file_size );
+        hashes_.push_back( desc.file_hash );
+        name_offsets_.push_back( static_cast< uint32_t >( names_.size() ) );
+        name_lengths_.push_back( static_cast< uint16_t >( name_length ) );
+        flags_.push_back( desc.flags );
+
+        uint32_t reserved;
+        std::memcpy( &reserved, desc.gap0, sizeof( reserved ) );
+        reserved_.push_back( reserved );
+
+        names_.append( desc.name, name_length );
+        names_.push_back( '\0' );
+    }
+
+    void file_table::append( const file_table& other ) {
+        const auto names_base = static_cast< uint32_t >( names_.size() );
+
+        offsets_.insert( offsets_.end(), other.offsets_.begin(), other.offsets_.end() );
+        sizes_.insert( sizes_.end(), other.sizes_.begin(), other.sizes_.end() );
+        hashes_.insert( hashes_.end(), other.hashes_.begin(), other.hashes_.end() );
+        name_lengths_.insert( name_lengths_.end(), other.name_lengths_.begin(), other.name_lengths_.end() );
+        flags_.insert( flags_.end(), other.flags_.begin(), other.flags_.end() );
+        reserved_.insert( reserved_.end(), other.reserved_.begin(), other.reserved_.end() );
+        names_ += other.names_;
+
+        name_offsets_.reserve( name_offsets_.size() + other.name_offsets_.size() );
+        for ( const auto name_offset : other.name_offsets_ ) {
+            name_offsets_.push_back( names_base + name_offset );
+        }
+    }
+
+    file_desc_t file_table::desc( size_t index ) const noexcept {
+        file_desc_t result {};
+
+        const auto entry_name = name( index );
+        std::memcpy( result.name, entry_name.data(), entry_name.size() );
+        std::memcpy( result.gap0, &reserved_[ index ], sizeof( result.gap0 ) );
+        result.flags = flags_[ index ];
+        result.name_length = static_cast< uint16_t >( entry_name.size() );
+        result.file_hash = hashes_[ index ];
+        result.file_size = sizes_[ index ];
+        result.file_offset = offsets_[ index ];
+
+        return result;
+    }
+
+    void file_table::serialize( std::vector< uint8_t >& out ) const {
+        detail::write_array< uint64_t >( out, offsets_ );
+        detail::write_array< uint64_t >( out, sizes_ );
+        detail::write_array< uint64_t >( out, hashes_ );
+        detail::write_array< uint32_t >( out, name_offsets_ );
+        detail::write_array< uint16_t >( out, name_lengths_ );
+        detail::write_array< uint16_t >( out, flags_ );
+        detail::write_array< uint32_t >( out, reserved_ );
+        detail::write_array< char >( out, names_ );
+    }
+
+    bool file_table::deserialize( std::span< const uint8_t >& data ) {
+        std::vector< char > names;
+
+        const bool read = detail::read_array( data, offsets_ ) && detail::read_array( data, sizes_ ) &&
+                          detail::read_array( data, hashes_ ) && detail::read_array( data, name_offsets_ ) &&
+                          detail::read_array( data, name_lengths_ ) && detail::read_array( data, flags_ ) &&
+                          detail::read_array( data, reserved_ ) && detail::read_array( data, names );
+
+        names_.assign( names.begin(), names.end() );
+
+        auto valid = read && sizes_.size() == size() && hashes_.size() == size() && name_offsets_.size() == size() &&
+                     name_lengths_.size() == size() && flags_.size() == size() && reserved_.size() == size();
+
+        // Every name must lie inside the pool, followed by its terminator
+        for ( size_t i = 0; valid && i < size(); i++ ) {
+            valid = static_cast< uint64_t >( name_offsets_[ i ] ) + name_lengths_[ i ] < names_.size();
+        }
+
+        if ( !valid )
+            *this = {};
+
+        return valid;
+    }
+
+    size_t file_table::memory_usage() const noexcept {
+        return offsets_.capacity() * sizeof( uint64_t ) + sizes_.capacity() * sizeof( uint64_t ) + hashes_.capacity() * sizeof( uint64_t ) +
+               name_offsets_.capacity() * sizeof( uint32_t ) + name_lengths_.capacity() * sizeof( uint16_t ) +
+               flags_.capacity() * sizeof( uint16_t ) + reserved_.capacity() * sizeof( uint32_t ) + names_.capacity();
+    }
+
+} // namespace kspkg
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include <kspkg-core/generator.hpp>
+#include <kspkg-core/cipher.hpp>
+
+#include "hash.hpp"
+#include "metadata.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace kspkg {
+
+    namespace {
+
+        constexpr size_t kWriteChunkSize = 0x100000; // 1 MB, a multiple of the key size
+
+        uint64_t splitmix64( uint64_t& state ) {
+            uint64_t z = ( state += 0x9E3779B97F4A7C15 );
+            z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9;
+            z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EB;
+            return z ^ ( z >> 31 );
+        }
+
+        double next_unit( uint64_t& state ) {
+            return static_cast< double >( splitmix64( state ) >> 11 ) * 0x1.0p-53;
+        }
+
+        /**
+         * @brief Deterministic content stream of one entry, produced 8 bytes at a time
+         */
+        class content_stream {
+        public:
+            content_stream( uint64_t seed, size_t index ) : state_( seed ^ ( ( index + 1 ) * 0xD6E8FEB86659FD93 ) ) { }
+
+            // `data.size()` must be a multiple of 8 unless this is the last chunk of the entry
+            void fill( std::span< uint8_t > data ) {
+                for ( size_t i = 0; i < data.size(); i += sizeof( uint64_t ) ) {
+                    const uint64_t word = splitmix64( state_ );
+                    std::memcpy( data.data() + i, &word, std::min( sizeof( word ), data.size() - i ) );
+                }
+            }
+
+        private:
+            uint64_t state_;
+        };
+
+        uint64_t pick_size( const generator_options_t& options, uint64_t& rng ) {
+            const auto span = options.max_file_size - options.min_file_size;
+
+            if ( options.size_distribution == size_distribution_t::kUniform ) {
+                return span == UINT64_MAX ? splitmix64( rng ) : options.min_file_size + splitmix64( rng ) % ( span + 1 );
+            }
+
+            const double low = std::log( static_cast< double >( options.min_file_size ) + 1.0 );
+            const double high = std::log( static_cast< double >( options.max_file_size ) + 1.0 );
+            const auto size = static_cast< uint64_t >( std::exp( low + ( high - low ) * next_unit( rng ) ) - 1.0 );
+
+            return std::clamp( size, options.min_file_size, options.max_file_size );
+        }
+
+        std::string pick_name( const generator_options_t& options, size_t index, uint64_t& rng ) {
+            static constexpr const char* kExtensions[] = { ".txt", ".json", ".loc", ".png", ".dds", ".bin" };
+
+            std::string name;
+            const auto depth = options.directory_depth ? splitmix64( rng ) % ( options.directory_depth + 1 ) : 0;
+            for ( size_t level = 0; level < depth; level++ ) {
+                name += "dir_" + std::to_string( splitmix64( rng ) % std::max< size_t >( options.directory_fanout, 1 ) ) + "\\";
+            }
+
+            name += "entry_" + std::to_string( index ) + kExtensions[ splitmix64( rng ) % std::size( kExtensions ) ];
+            return name;
+        }
+
+    } // namespace
+
+    expected< std::vector< generated_entry_t > > generate_package( const std::filesystem::path& path, const generator_options_t& options ) {
+        if ( options.entry_count > kMaxFileCount )
+            return unexpected( "Too many entries for the metadata block." );
+        if ( options.min_file_size > options.max_file_size )
+            return unexpected( "Minimum file size is larger than the maximum." );
+        if ( options.encrypted_ratio < 0.0 || options.encrypted_ratio > 1.0 )
+            return unexpected( "Encrypted ratio must be between 0 and 1." );
+
+        std::ofstream fs( path, std::ios::binary | std::ios::trunc );
+        if ( !fs.is_open() )
+            return unexpected( "Failed to open the package file for writing." );
+
+        uint64_t rng = options.seed;
+        std::vector< generated_entry_t > entries;
+        std::vector< file_desc_t > descs;
+        std::vector< uint8_t > buffer( kWriteChunkSize );
+        uint64_t offset = 0;
+
+        entries.reserve( options.entry_count );
+        descs.reserve( options.entry_count );
+
+        for ( size_t i = 0; i < options.entry_count; i++ ) {
+            generated_entry_t entry;
+            entry.name = pick_name( options, i, rng );
+            entry.file_size = pick_size( options, rng );
+            entry.file_offset = offset;
+            entry.is_encrypted = next_unit( rng ) < options.encrypted_ratio;
+
+            if ( entry.name.size() > sizeof( file_desc_t::name ) )
+                return unexpected( "Generated name does not fit the descriptor, reduce the directory depth." );
+
+            content_stream content( options.seed, i );
+            for ( uint64_t done = 0; done < entry.file_size; ) {
+                const auto length = static_cast< size_t >( std::min< uint64_t >( kWriteChunkSize, entry.file_size - done ) );
+                const auto chunk = std::span( buffer ).first( length );
+                content.fill( chunk );
+
+                if ( entry.is_encrypted ) {
+                    detail::encrypt_decrypt_data( chunk, detail::key_at_offset( kXorKey, done ) );
+                }
+
+                fs.write( reinterpret_cast< const char* >( chunk.data() ), static_cast< std::streamsize >( chunk.size() ) );
+                done += chunk.size();
+            }
+
+            file_desc_t desc {};
+            std::memcpy( desc.name, entry.name.data(), entry.name.size() );
+            desc.flags = entry.is_encrypted ? static_cast< uint16_t >( file_flags_t::kIsEncrypted ) : 0;
+            desc.name_length = static_cast< uint16_t >( entry.name.size() );
+            desc.file_hash = detail::fnv1a( entry.name ) | 1; // Zero marks an empty slot
+            desc.file_size = entry.file_size;
+            desc.file_offset = entry.file_offset;
+
+            descs.push_back( desc );
+            offset += entry.file_size;
+            entries.push_back( std::move( entry ) );
+        }
+
+        const auto metadata = detail::encode_metadata( descs );
+        fs.write( reinterpret_cast< const char* >( metadata.data() ), static_cast< std::streamsize >( metadata.size() ) );
+
+        if ( !fs )
+            return unexpected( "Failed to write the package file." );
+
+        return entries;
+    }
+
+    std::vector< uint8_t > generated_entry_content( const generator_options_t& options, size_t index, uint64_t file_size ) {
+        std::vector< uint8_t > result( file_size );
+        content_stream( options.seed, index ).fill( result );
+        return result;
+    }
+
+} // namespace kspkg
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace kspkg::detail {
+
+    constexpr uint64_t kFnvOffsetBasis = 0xCBF29CE484222325;
+
+    /**
+     * @brief 64-bit FNV-1a, `hash` continues a previous call
+     */
+    constexpr uint64_t fnv1a( std::span< const uint8_t > data, uint64_t hash = kFnvOffsetBasis ) noexcept {
+        for ( const uint8_t byte : data ) {
+            hash = ( hash ^ byte ) * 0x100000001B3;
+        }
+        return hash;
+    }
+
+    constexpr uint64_t fnv1a( std::string_view text, uint64_t hash = kFnvOffsetBasis ) noexcept {
+        for ( const char c : text ) {
+            hash = ( hash ^ static_cast< uint8_t >( c ) ) * 0x100000001B3;
+        }
+        return hash;
+    }
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,496 @@
+#include "io_uring_extract.hpp"
+
+#include <kspkg-core/cipher.hpp>
+
+#if defined( __linux__ ) && __has_include( <linux/io_uring.h> )
+    #define KSPKG_HAS_IO_URING 1
+
+    #include <algorithm>
+    #include <atomic>
+    #include <cerrno>
+    #include <cstring>
+    #include <deque>
+    #include <memory>
+    #include <string>
+
+    #include <fcntl.h>
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace kspkg::detail {
+
+#ifdef KSPKG_HAS_IO_URING
+    namespace {
+
+        constexpr uint64_t kSegmentSize = 0x400000;       // 4 MB reads for entries that do not fit into a run
+        constexpr uint64_t kMaxInflightBytes = 0x4000000; // Read buffers alive at once, 64 MB
+        constexpr uint64_t kWriteFlag = 1ull << 63;       // Marks write requests in `user_data`
+
+        /**
+         * @brief Minimal io_uring over the raw syscalls, so liburing is not needed
+         */
+        class ring_t {
+        public:
+            ring_t() = default;
+            ~ring_t() {
+                if ( sqes_ )
+                    munmap( sqes_, sqes_size_ );
+                if ( cq_ring_ && cq_ring_ != sq_ring_ )
+                    munmap( cq_ring_, cq_ring_size_ );
+                if ( sq_ring_ )
+                    munmap( sq_ring_, sq_ring_size_ );
+                if ( fd_ >= 0 )
+                    ::close( fd_ );
+            }
+
+            ring_t( const ring_t& ) = delete;
+            ring_t& operator=( const ring_t& ) = delete;
+
+            bool init( unsigned entries ) {
+                io_uring_params params {};
+                fd_ = static_cast< int >( syscall( __NR_io_uring_setup, entries, &params ) );
+                if ( fd_ < 0 )
+                    return false;
+
+                sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+                cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+
+                const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+                if ( single_mmap )
+                    sq_ring_size_ = cq_ring_size_ = std::max( sq_ring_size_, cq_ring_size_ );
+
+                sq_ring_ = map( sq_ring_size_, IORING_OFF_SQ_RING );
+                cq_ring_ = single_mmap ? sq_ring_ : map( cq_ring_size_, IORING_OFF_CQ_RING );
+
+                sqes_size_ = params.sq_entries * sizeof( io_uring_sqe );
+                sqes_ = static_cast< io_uring_sqe* >( map( sqes_size_, IORING_OFF_SQES ) );
+
+                if ( !sq_ring_ || !cq_ring_ || !sqes_ )
+                    return false;
+
+                auto* sq = static_cast< uint8_t* >( sq_ring_ );
+                sq_head_ = reinterpret_cast< unsigned* >( sq + params.sq_off.head );
+                sq_tail_ = reinterpret_cast< unsigned* >( sq + params.sq_off.tail );
+                sq_mask_ = *reinterpret_cast< unsigned* >( sq + params.sq_off.ring_mask );
+                sq_array_ = reinterpret_cast< unsigned* >( sq + params.sq_off.array );
+                sq_entries_ = params.sq_entries;
+
+                auto* cq = static_cast< uint8_t* >( cq_ring_ );
+                cq_head_ = reinterpret_cast< unsigned* >( cq + params.cq_off.head );
+                cq_tail_ = reinterpret_cast< unsigned* >( cq + params.cq_off.tail );
+                cq_mask_ = *reinterpret_cast< unsigned* >( cq + params.cq_off.ring_mask );
+                cqes_ = reinterpret_cast< io_uring_cqe* >( cq + params.cq_off.cqes );
+
+                return true;
+            }
+
+            /**
+             * @brief Whether the kernel implements the opcode, kernels before 5.6 know neither the probe nor plain reads and writes
+             */
+            [[nodiscard]] bool supports( uint8_t opcode ) const noexcept {
+                constexpr unsigned kProbeOps = 256;
+                alignas( io_uring_probe ) uint8_t storage[ sizeof( io_uring_probe ) + kProbeOps * sizeof( io_uring_probe_op ) ] {};
+                auto* probe = reinterpret_cast< io_uring_probe* >( storage );
+
+                if ( syscall( __NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, kProbeOps ) < 0 )
+                    return false;
+
+                return opcode <= probe->last_op && opcode < probe->ops_len && ( probe->ops[ opcode ].flags & IO_URING_OP_SUPPORTED );
+            }
+
+            [[nodiscard]] unsigned capacity() const noexcept {
+                return sq_entries_;
+            }
+
+            /**
+             * @brief Queue a read or write, the caller keeps the number of requests in flight within `capacity()`
+             */
+            void push( uint8_t opcode, int fd, void* data, uint32_t length, uint64_t offset, uint64_t user_data ) noexcept {
+                const unsigned tail = *sq_tail_;
+                const unsigned index = tail & sq_mask_;
+
+                io_uring_sqe& sqe = sqes_[ index ];
+                std::memset( &sqe, 0, sizeof( sqe ) );
+                sqe.opcode = opcode;
+                sqe.fd = fd;
+                sqe.addr = reinterpret_cast< uint64_t >( data );
+                sqe.len = length;
+                sqe.off = offset;
+                sqe.user_data = user_data;
+
+                sq_array_[ index ] = index;
+                std::atomic_ref( *sq_tail_ ).store( tail + 1, std::memory_order_release );
+                queued_++;
+            }
+
+            /**
+             * @brief Submit queued requests and wait until at least one completion is available
+             */
+            bool submit_and_wait() noexcept {
+                for ( ;; ) {
+                    const auto submitted = syscall( __NR_io_uring_enter, fd_, queued_, 1, IORING_ENTER_GETEVENTS, nullptr, 0 );
+                    if ( submitted >= 0 ) {
+                        queued_ -= static_cast< unsigned >( submitted );
+                        return true;
+                    }
+                    if ( errno != EINTR )
+                        return false;
+                }
+            }
+
+            /**
+             * @brief Wait for a completion without submitting anything
+             */
+            bool wait() noexcept {
+                for ( ;; ) {
+                    if ( syscall( __NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0 ) >= 0 )
+                        return true;
+                    if ( errno != EINTR )
+                        return false;
+                }
+            }
+
+            /**
+             * @brief Requests queued but not yet handed to the kernel
+             */
+            [[nodiscard]] unsigned queued() const noexcept {
+                return queued_;
+            }
+
+            template < typename handler_t >
+            void drain( handler_t&& handler ) {
+                unsigned head = *cq_head_;
+                while ( head != std::atomic_ref( *cq_tail_ ).load( std::memory_order_acquire ) ) {
+                    const io_uring_cqe cqe = cqes_[ head & cq_mask_ ];
+                    std::atomic_ref( *cq_head_ ).store( ++head, std::memory_order_release );
+                    handler( cqe.user_data, cqe.res );
+                }
+            }
+
+        private:
+            void* map( size_t size, uint64_t offset ) const noexcept {
+                void* view = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, static_cast< off_t >( offset ) );
+                return view == MAP_FAILED ? nullptr : view;
+            }
+
+            int fd_ = -1;
+            void* sq_ring_ = nullptr;
+            void* cq_ring_ = nullptr;
+            io_uring_sqe* sqes_ = nullptr;
+            size_t sq_ring_size_ = 0;
+            size_t cq_ring_size_ = 0;
+            size_t sqes_size_ = 0;
+
+            unsigned* sq_head_ = nullptr;
+            unsigned* sq_tail_ = nullptr;
+            unsigned* sq_array_ = nullptr;
+            unsigned sq_mask_ = 0;
+            unsigned sq_entries_ = 0;
+
+            unsigned* cq_head_ = nullptr;
+            unsigned* cq_tail_ = nullptr;
+            io_uring_cqe* cqes_ = nullptr;
+            unsigned cq_mask_ = 0;
+
+            unsigned queued_ = 0;
+        };
+
+        /**
+         * @brief One read from the package
+         */
+        struct unit_t {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            uint64_t done = 0;
+            size_t first_piece = 0;
+            size_t piece_count = 0;
+            size_t pending_writes = 0;
+            std::unique_ptr< uint8_t[] > buffer {};
+        };
+
+        /**
+         * @brief Part of an entry that lives inside one unit and is written with one request
+         */
+        struct piece_t {
+            size_t request = 0;         // Position in `files`
+            size_t unit = 0;
+            uint64_t entry_offset = 0;  // Position inside the entry, and inside the output file
+            uint64_t buffer_offset = 0; // Position inside the unit buffer
+            uint64_t length = 0;
+            uint64_t written = 0;
+        };
+
+        struct output_t {
+            int fd = -1;
+            uint64_t remaining = 0; // Bytes not yet accounted for by a finished or failed piece
+            bool opened = false;
+
+            ~output_t() {
+                if ( fd >= 0 )
+                    ::close( fd );
+            }
+        };
+
+        std::string errno_message( const char* what, int error ) {
+            return std::string( what ) + ": " + std::strerror( error );
+        }
+
+    } // namespace
+
+    bool is_io_uring_available() noexcept {
+        static const bool available = [] {
+            ring_t ring;
+            return ring.init( 1 ) && ring.supports( IORING_OP_READ ) && ring.supports( IORING_OP_WRITE );
+        }();
+
+        return available;
+    }
+
+    bool extract_with_io_uring( const file_handle& handle, const std::vector< file >& files, std::span< const size_t > order,
+                                std::span< const read_run_t > runs, const std::filesystem::path& out_directory, size_t queue_depth,
+                                std::vector< extract_result_t >& results ) {
+        ring_t ring;
+        if ( !ring.init( static_cast< unsigned >( std::clamp< size_t >( queue_depth, 1, 4096 ) ) ) )
+            return false;
+
+        // Completions are only handled once the ring is idle enough, so the completion queue never overflows
+        const size_t depth = ring.capacity();
+        const int package_fd = handle.native_handle();
+
+        std::vector< unit_t > units;
+        std::vector< piece_t > pieces;
+        const auto outputs = std::make_unique< output_t[] >( files.size() );
+
+        for ( size_t i = 0; i < files.size(); i++ ) {
+            results[ i ] = { files[ i ], {} };
+            outputs[ i ].remaining = files[ i ].get_file_size();
+        }
+
+        const auto fail = [ & ]( size_t request, std::string message ) {
+            if ( results[ request ].status )
+                results[ request ].status = unexpected( std::move( message ) );
+        };
+
+        // The output is complete once every byte of the entry went through a finished or failed piece
+        const auto account = [ & ]( size_t request, uint64_t length ) {
+            auto& output = outputs[ request ];
+            output.remaining -= length;
+
+            if ( output.remaining == 0 && output.fd >= 0 ) {
+                if ( ::close( output.fd ) != 0 )
+                    fail( request, errno_message( "Failed to close the output file", errno ) );
+                output.fd = -1;
+            }
+        };
+
+        const auto open_output = [ & ]( size_t request ) {
+            auto& output = outputs[ request ];
+            if ( output.opened )
+                return output.fd >= 0;
+
+            output.opened = true;
+
+            const auto out_path = prepare_output_path( files[ request ], out_directory );
+            if ( !out_path ) {
+                fail( request, out_path.error() );
+                return false;
+            }
+
+            output.fd = ::open( out_path->c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+            if ( output.fd < 0 ) {
+                fail( request, "Failed to open the output file." );
+                return false;
+            }
+
+            return true;
+        };
+
+        // Split the plan into reads and pieces
+        for ( const auto& run : runs ) {
+            const size_t request = order[ run.begin ];
+            const auto& entry = files[ request ];
+
+            if ( run.streamed && entry.is_directory() ) {
+                results[ request ].status = unexpected( "Cannot extract a directory." );
+                continue;
+            }
+
+            if ( run.streamed ) {
+                for ( uint64_t done = 0; done < run.size; done += kSegmentSize ) {
+                    const uint64_t length = std::min( kSegmentSize, run.size - done );
+                    pieces.push_back( { request, units.size(), done, 0, length } );
+                    units.push_back( { run.offset + done, length, 0, pieces.size() - 1, 1 } );
+                }
+                continue;
+            }
+
+            unit_t unit { run.offset, run.size, 0, pieces.size(), 0 };
+            for ( size_t k = run.begin; k < run.end; k++ ) {
+                const auto& file = files[ order[ k ] ];
+
+                // Empty entries have nothing to read or write, only the file is created
+                if ( file.get_file_size() == 0 ) {
+                    if ( open_output( order[ k ] ) )
+                        account( order[ k ], 0 );
+                    continue;
+                }
+
+                pieces.push_back( { order[ k ], units.size(), 0, file.get_file_offset() - run.offset, file.get_file_size() } );
+                unit.piece_count++;
+            }
+
+            if ( unit.piece_count )
+                units.push_back( std::move( unit ) );
+        }
+
+        std::deque< size_t > ready_writes;
+        size_t next_unit = 0;
+        size_t in_flight = 0;
+        uint64_t buffered_bytes = 0;
+
+        const auto release_piece = [ & ]( piece_t& piece ) {
+            auto& unit = units[ piece.unit ];
+            account( piece.request, piece.length );
+
+            if ( --unit.pending_writes == 0 ) {
+                buffered_bytes -= unit.size;
+                unit.buffer.reset();
+            }
+        };
+
+        const auto push_write = [ & ]( size_t piece_index ) {
+            auto& piece = pieces[ piece_index ];
+            auto* data = units[ piece.unit ].buffer.get() + piece.buffer_offset + piece.written;
+            const auto length = static_cast< uint32_t >( std::min< uint64_t >( piece.length - piece.written, 0x40000000 ) );
+
+            ring.push( IORING_OP_WRITE, outputs[ piece.request ].fd, data, length, piece.entry_offset + piece.written,
+                       kWriteFlag | piece_index );
+            in_flight++;
+        };
+
+        const auto push_read = [ & ]( size_t unit_index ) {
+            auto& unit = units[ unit_index ];
+            const auto length = static_cast< uint32_t >( std::min< uint64_t >( unit.size - unit.done, 0x40000000 ) );
+
+            ring.push( IORING_OP_READ, package_fd, unit.buffer.get() + unit.done, length, unit.offset + unit.done, unit_index );
+            in_flight++;
+        };
+
+        const auto on_read = [ & ]( size_t unit_index, int result ) {
+            auto& unit = units[ unit_index ];
+
+            if ( result > 0 && unit.done + static_cast< uint64_t >( result ) < unit.size ) {
+                // Short read, fetch the rest
+                unit.done += static_cast< uint64_t >( result );
+                push_read( unit_index );
+                return;
+            }
+
+            unit.pending_writes = unit.piece_count;
+
+            for ( size_t i = unit.first_piece; i < unit.first_piece + unit.piece_count; i++ ) {
+                auto& piece = pieces[ i ];
+
+                if ( result <= 0 ) {
+                    fail( piece.request, result < 0 ? errno_message( "Failed to read from the file", -result ) : "Failed to read from the file." );
+                    release_piece( piece );
+                    continue;
+                }
+
+                if ( !open_output( piece.request ) ) {
+                    release_piece( piece );
+                    continue;
+                }
+
+                if ( files[ piece.request ].is_encrypted() ) {
+                    // Keep the key phase aligned with the position inside the entry
+                    encrypt_decrypt_data( { unit.buffer.get() + piece.buffer_offset, piece.length },
+                                          key_at_offset( kXorKey, piece.entry_offset ) );
+                }
+
+                ready_writes.push_back( i );
+            }
+        };
+
+        const auto on_write = [ & ]( size_t piece_index, int result ) {
+            auto& piece = pieces[ piece_index ];
+
+            if ( result <= 0 ) {
+                fail( piece.request, result < 0 ? errno_message( "Failed to write the output file", -result ) : "Failed to write the output file." );
+                release_piece( piece );
+                return;
+            }
+
+            piece.written += static_cast< uint64_t >( result );
+            if ( piece.written < piece.length )
+                ready_writes.push_back( piece_index );
+            else
+                release_piece( piece );
+        };
+
+        while ( next_unit < units.size() || in_flight != 0 || !ready_writes.empty() ) {
+            // Writes first, they release read buffers
+            while ( in_flight < depth && !ready_writes.empty() ) {
+                push_write( ready_writes.front() );
+                ready_writes.pop_front();
+            }
+
+            while ( in_flight < depth && next_unit < units.size() &&
+                    ( buffered_bytes == 0 || buffered_bytes + units[ next_unit ].size <= kMaxInflightBytes ) ) {
+                auto& unit = units[ next_unit ];
+                unit.buffer = std::make_unique_for_overwrite< uint8_t[] >( unit.size );
+                buffered_bytes += unit.size;
+                push_read( next_unit++ );
+            }
+
+            if ( in_flight == 0 )
+                continue;
+
+            if ( !ring.submit_and_wait() ) {
+                // The ring broke down, report what is left instead of waiting forever
+                for ( auto& result : results ) {
+                    if ( result.status && outputs[ &result - results.data() ].remaining != 0 )
+                        result.status = unexpected( "io_uring submission failed." );
+                }
+
+                // Requests the kernel already took still read into or write from the unit buffers, let them finish
+                // before the buffers go away. Should even that fail, leak the buffers rather than free them under the kernel
+                size_t submitted = in_flight - ring.queued();
+                while ( submitted != 0 ) {
+                    if ( !ring.wait() ) {
+                        for ( auto& unit : units )
+                            static_cast< void >( unit.buffer.release() );
+                        break;
+                    }
+                    ring.drain( [ & ]( uint64_t, int ) { submitted--; } );
+                }
+                break;
+            }
+
+            ring.drain( [ & ]( uint64_t user_data, int result ) {
+                in_flight--;
+
+                if ( user_data & kWriteFlag )
+                    on_write( static_cast< size_t >( user_data & ~kWriteFlag ), result );
+                else
+                    on_read( static_cast< size_t >( user_data ), result );
+            } );
+        }
+
+        return true;
+    }
+#else
+    bool is_io_uring_available() noexcept {
+        return false;
+    }
+
+    bool extract_with_io_uring( const file_handle&, const std::vector< file >&, std::span< const size_t >, std::span< const read_run_t >,
+                                const std::filesystem::path&, size_t, std::vector< extract_result_t >& ) {
+        return false;
+    }
+#endif
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "extract_plan.hpp"
+
+#include <kspkg-core/core.hpp>
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace kspkg::detail {
+
+    /**
+     * @brief Whether io_uring can be used, it may be missing from the build or the kernel, blocked by a seccomp filter, or lack plain reads and writes
+     */
+    [[nodiscard]] bool is_io_uring_available() noexcept;
+
+    /**
+     * @brief Extract planned runs on one io_uring, keeping up to `queue_depth` reads and writes in flight
+     *
+     * Runs are read in offset order, entries are decrypted as their read completes and written with their own requests.
+     *
+     * @param handle Package file
+     * @param files Requested files
+     * @param order Offset order of the requests, see `offset_order`
+     * @param runs Runs planned over `order`, see `plan_runs`
+     * @param out_directory Directory to extract the files
+     * @param queue_depth Maximum number of requests in flight
+     * @param results Per-request results, in request order
+     * @return False when the ring could not be set up, nothing has been extracted then
+     */
+    bool extract_with_io_uring( const file_handle& handle, const std::vector< file >& files, std::span< const size_t > order,
+                                std::span< const read_run_t > runs, const std::filesystem::path& out_directory, size_t queue_depth,
+                                std::vector< extract_result_t >& results );
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include <kspkg-core/mapped_file.hpp>
+
+#include <utility>
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace kspkg::detail {
+
+    mapped_file::~mapped_file() {
+        close();
+    }
+
+    mapped_file::mapped_file( mapped_file&& other ) noexcept
+        : data_( std::exchange( other.data_, nullptr ) ), size_( std::exchange( other.size_, 0 ) )
+#ifdef _WIN32
+          ,
+          file_handle_( std::exchange( other.file_handle_, nullptr ) ), mapping_handle_( std::exchange( other.mapping_handle_, nullptr ) )
+#endif
+    {
+    }
+
+    mapped_file& mapped_file::operator=( mapped_file&& other ) noexcept {
+        if ( this != &other ) {
+            close();
+            data_ = std::exchange( other.data_, nullptr );
+            size_ = std::exchange( other.size_, 0 );
+#ifdef _WIN32
+            file_handle_ = std::exchange( other.file_handle_, nullptr );
+            mapping_handle_ = std::exchange( other.mapping_handle_, nullptr );
+#endif
+        }
+        return *this;
+    }
+
+#ifdef _WIN32
+    std::expected< mapped_file, std::string > mapped_file::open( const std::filesystem::path& path ) {
+        // Share write/delete access so the package can still be patched while it is mapped
+        const HANDLE file = CreateFileW( path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+        if ( file == INVALID_HANDLE_VALUE )
+            return std::unexpected( "Failed to open the file for mapping." );
+
+        LARGE_INTEGER file_size {};
+        if ( !GetFileSizeEx( file, &file_size ) || file_size.QuadPart == 0 ) {
+            CloseHandle( file );
+            return std::unexpected( "Failed to map an empty file." );
+        }
+
+        const HANDLE mapping = CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+        if ( !mapping ) {
+            CloseHandle( file );
+            return std::unexpected( "Failed to create the file mapping." );
+        }
+
+        const auto* view = static_cast< const uint8_t* >( MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) );
+        if ( !view ) {
+            CloseHandle( mapping );
+            CloseHandle( file );
+            return std::unexpected( "Failed to map the file view." );
+        }
+
+        mapped_file result;
+        result.data_ = view;
+        result.size_ = static_cast< size_t >( file_size.QuadPart );
+        result.file_handle_ = file;
+        result.mapping_handle_ = mapping;
+        return result;
+    }
+
+    void mapped_file::advise( uint64_t offset, uint64_t length, access_hint_t hint ) const noexcept {
+        if ( hint != access_hint_t::kWillNeed || offset >= size_ )
+            return;
+
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = const_cast< uint8_t* >( data_ + offset );
+        range.NumberOfBytes = static_cast< SIZE_T >( length == 0 || length > size_ - offset ? size_ - offset : length );
+        PrefetchVirtualMemory( GetCurrentProcess(), 1, &range, 0 );
+    }
+
+    void mapped_file::close() noexcept {
+        if ( data_ )
+            UnmapViewOfFile( data_ );
+        if ( mapping_handle_ )
+            CloseHandle( mapping_handle_ );
+        if ( file_handle_ )
+            CloseHandle( file_handle_ );
+
+        data_ = nullptr;
+        size_ = 0;
+        mapping_handle_ = nullptr;
+        file_handle_ = nullptr;
+    }
+#else
+    std::expected< mapped_file, std::string > mapped_file::open( const std::filesystem::path& path ) {
+        const int fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+        if ( fd < 0 )
+            return std::unexpected( "Failed to open the file for mapping." );
+
+        struct stat st {};
+        if ( fstat( fd, &st ) != 0 || st.st_size == 0 ) {
+            ::close( fd );
+            return std::unexpected( "Failed to map an empty file." );
+        }
+
+        void* view = mmap( nullptr, static_cast< size_t >( st.st_size ), PROT_READ, MAP_SHARED, fd, 0 );
+
+        // The mapping keeps its own reference to the file
+        ::close( fd );
+
+        if ( view == MAP_FAILED )
+            return std::unexpected( "Failed to map the file view." );
+
+        mapped_file result;
+        result.data_ = static_cast< const uint8_t* >( view );
+        result.size_ = static_cast< size_t >( st.st_size );
+        return result;
+    }
+
+    void mapped_file::advise( uint64_t offset, uint64_t length, access_hint_t hint ) const noexcept {
+        if ( offset >= size_ )
+            return;
+
+        // madvise wants a page-aligned start
+        const auto page_size = static_cast< uint64_t >( sysconf( _SC_PAGESIZE ) );
+        const auto start = offset / page_size * page_size;
+        const auto end = length == 0 || length > size_ - offset ? size_ : offset + length;
+
+        const int advice = hint == access_hint_t::kSequential ? MADV_SEQUENTIAL
+                           : hint == access_hint_t::kWillNeed  ? MADV_WILLNEED
+                                                               : MADV_NORMAL;
+        madvise( const_cast< uint8_t* >( data_ + start ), static_cast< size_t >( end - start ), advice );
+    }
+
+    void mapped_file::close() noexcept {
+        if ( data_ )
+            munmap( const_cast< uint8_t* >( data_ ), size_ );
+
+        data_ = nullptr;
+        size_ = 0;
+    }
+#endif
+
+} // namespace kspkg::detail
\ No newline at end of file
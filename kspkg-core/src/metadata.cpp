@@ -0,0 +1,235 @@
+#include "metadata.hpp"
+
+#include "work_stealing_pool.hpp"
+
+#include <kspkg-core/cipher.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+#ifdef _WIN32
+    #include <fstream>
+#else
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #if defined( __linux__ )
+        #include <linux/fs.h>
+        #include <sys/ioctl.h>
+    #endif
+#endif
+
+namespace kspkg::detail {
+
+    namespace {
+
+        constexpr size_t kStripeSlots = 0x800; // 512 KB of metadata per stripe
+        constexpr size_t kStripeSize = kStripeSlots * sizeof( file_desc_t );
+        constexpr size_t kStripeCount = kMaxFileCount / kStripeSlots;
+        constexpr size_t kHashOffset = offsetof( file_desc_t, file_hash );
+        constexpr size_t kPatternBufferSize = 0x100000; // 1 MB of the bare key pattern, also the stretch a shared tail is cloned from
+
+        static_assert( kMaxFileCount % kStripeSlots == 0, "Stripes must cover the metadata block exactly" );
+        static_assert( sizeof( file_desc_t ) % sizeof( uint64_t ) == 0 && kHashOffset % sizeof( uint64_t ) == 0,
+                       "Slots and hashes must start at key-aligned offsets" );
+
+        /**
+         * @brief Collect the occupied slots of one encrypted stripe
+         */
+        void decode_stripe( std::span< const uint8_t > stripe, file_table& files ) {
+            for ( size_t offset = 0; offset + sizeof( file_desc_t ) <= stripe.size(); offset += sizeof( file_desc_t ) ) {
+                // Slots start at key-aligned offsets, so an empty slot has exactly the key in its hash field
+                uint64_t encrypted_hash;
+                std::memcpy( &encrypted_hash, stripe.data() + offset + kHashOffset, sizeof( encrypted_hash ) );
+                if ( encrypted_hash == kXorKey )
+                    continue;
+
+                file_desc_t desc;
+                std::memcpy( &desc, stripe.data() + offset, sizeof( desc ) );
+                encrypt_decrypt_data( { reinterpret_cast< uint8_t* >( &desc ), sizeof( desc ) }, kXorKey );
+
+                files.push_back( desc );
+            }
+        }
+
+        /**
+         * @brief Run `decode( stripe, files )` for every stripe and join the partial tables in stripe order
+         */
+        template < typename decode_t >
+        file_table decode_stripes( size_t concurrency, decode_t&& decode ) {
+            std::vector< file_table > partial( kStripeCount );
+
+            if ( concurrency == 0 )
+                concurrency = std::max( 1u, std::thread::hardware_concurrency() );
+
+            if ( concurrency == 1 ) {
+                for ( size_t stripe = 0; stripe < kStripeCount; stripe++ ) {
+                    decode( stripe, partial[ stripe ] );
+                }
+            }
+            else {
+                work_stealing_pool pool( std::min( concurrency, kStripeCount ) );
+                pool.parallel_for( kStripeCount, [ & ]( size_t stripe ) { decode( stripe, partial[ stripe ] ); } );
+            }
+
+            size_t total = 0;
+            for ( const auto& files : partial ) {
+                total += files.size();
+            }
+
+            file_table files;
+            files.reserve( total );
+            for ( const auto& stripe_files : partial ) {
+                files.append( stripe_files );
+            }
+
+            return files;
+        }
+
+    } // namespace
+
+    std::vector< uint8_t > encode_metadata( std::span< const file_desc_t > descs ) {
+        std::vector< uint8_t > metadata( kMetadataSize );
+
+        const auto count = std::min( descs.size(), kMaxFileCount );
+        std::memcpy( metadata.data(), descs.data(), count * sizeof( file_desc_t ) );
+
+        encrypt_decrypt_data( metadata, kXorKey );
+        return metadata;
+    }
+
+    std::vector< uint8_t > encode_metadata_slots( const file_table& files ) {
+        const auto count = std::min( files.size(), kMaxFileCount );
+        std::vector< uint8_t > slots( count * sizeof( file_desc_t ) );
+
+        for ( size_t i = 0; i < count; i++ ) {
+            const auto desc = files.desc( i );
+            std::memcpy( slots.data() + i * sizeof( file_desc_t ), &desc, sizeof( desc ) );
+        }
+
+        encrypt_decrypt_data( slots, kXorKey );
+        return slots;
+    }
+
+    std::expected< void, std::string > append_metadata_tail( const std::filesystem::path& path, uint64_t metadata_offset, bool share ) {
+        // Encrypted zeros from key phase 0, the extra key length lets a write start at any phase
+        std::vector< uint8_t > pattern( kPatternBufferSize + sizeof( kXorKey ) );
+        encrypt_decrypt_data( pattern, kXorKey );
+
+        const uint64_t end = metadata_offset + kMetadataSize;
+        const auto phase = [ & ]( uint64_t position ) { return static_cast< size_t >( ( position - metadata_offset ) % sizeof( kXorKey ) ); };
+
+#ifdef _WIN32
+        ( void )share;
+
+        std::error_code ec;
+        uint64_t position = std::filesystem::file_size( path, ec );
+        if ( ec || position < metadata_offset || position > end )
+            return std::unexpected( "The metadata block is not at the end of the package." );
+
+        std::ofstream stream( path, std::ios::binary | std::ios::app );
+        while ( stream && position < end ) {
+            const auto length = static_cast< size_t >( std::min< uint64_t >( kPatternBufferSize, end - position ) );
+            stream.write( reinterpret_cast< const char* >( pattern.data() + phase( position ) ), static_cast< std::streamsize >( length ) );
+            position += length;
+        }
+
+        stream.flush();
+        if ( !stream )
+            return std::unexpected( "Failed to write the package metadata." );
+
+        return {};
+#else
+        const int fd = ::open( path.c_str(), O_RDWR | O_CLOEXEC );
+        if ( fd < 0 )
+            return std::unexpected( "Failed to open the package file." );
+
+        const auto result = [ & ]() -> std::expected< void, std::string > {
+            struct stat st { };
+            if ( ::fstat( fd, &st ) != 0 || static_cast< uint64_t >( st.st_size ) < metadata_offset || static_cast< uint64_t >( st.st_size ) > end )
+                return std::unexpected( "The metadata block is not at the end of the package." );
+
+            uint64_t position = static_cast< uint64_t >( st.st_size );
+            const auto write_pattern = [ & ]( uint64_t to ) {
+                while ( position < to ) {
+                    const auto length = static_cast< size_t >( std::min< uint64_t >( kPatternBufferSize, to - position ) );
+                    const ssize_t written = ::pwrite( fd, pattern.data() + phase( position ), length, static_cast< off_t >( position ) );
+                    if ( written < 0 && errno == EINTR )
+                        continue;
+                    if ( written <= 0 )
+                        return false;
+
+                    position += static_cast< uint64_t >( written );
+                }
+                return true;
+            };
+
+    #if defined( __linux__ )
+            // Clones keep the key phase as long as source and destination are a whole number of blocks apart
+            const uint64_t block = std::max< uint64_t >( 0x1000, static_cast< uint64_t >( st.st_blksize ) );
+            const uint64_t seed = ( position + block - 1 ) / block * block;
+            const uint64_t shared_end = end / block * block;
+
+            if ( share && kPatternBufferSize % block == 0 && seed + kPatternBufferSize < shared_end ) {
+                if ( !write_pattern( seed + kPatternBufferSize ) )
+                    return std::unexpected( "Failed to write the package metadata." );
+
+                // Everything from the seed on is pattern, so every clone can double the length of the previous one
+                while ( position < shared_end ) {
+                    file_clone_range range { .src_fd = fd,
+                                             .src_offset = seed,
+                                             .src_length = std::min( position - seed, shared_end - position ),
+                                             .dest_offset = position };
+                    if ( ::ioctl( fd, FICLONERANGE, &range ) != 0 )
+                        break; // No reflinks on this file system, the rest is written out
+
+                    position += range.src_length;
+                }
+            }
+    #else
+            ( void )share;
+    #endif
+
+            if ( !write_pattern( end ) )
+                return std::unexpected( "Failed to write the package metadata." );
+
+            return {};
+        }();
+
+        ::close( fd );
+        return result;
+#endif
+    }
+
+    file_table decode_metadata( std::span< const uint8_t > metadata, size_t concurrency ) {
+        return decode_stripes( concurrency, [ & ]( size_t stripe, file_table& files ) {
+            decode_stripe( metadata.subspan( stripe * kStripeSize, kStripeSize ), files );
+        } );
+    }
+
+    std::expected< file_table, std::string > decode_metadata( const file_handle& handle, uint64_t metadata_offset, size_t concurrency ) {
+        std::atomic< bool > read_failed = false;
+
+        auto files = decode_stripes( concurrency, [ & ]( size_t stripe, file_table& stripe_files ) {
+            const auto buffer = std::make_unique_for_overwrite< uint8_t[] >( kStripeSize );
+            const std::span< uint8_t > data( buffer.get(), kStripeSize );
+
+            if ( !handle.read_at( metadata_offset + stripe * kStripeSize, data ) ) {
+                read_failed = true;
+                return;
+            }
+
+            decode_stripe( data, stripe_files );
+        } );
+
+        if ( read_failed )
+            return std::unexpected( "Failed to read the package metadata." );
+
+        return files;
+    }
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <kspkg-core/file_handle.hpp>
+#include <kspkg-core/file_table.hpp>
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace kspkg::detail {
+
+    /**
+     * @brief Build the encrypted `kMetadataSize` block for the descriptors, in slot order
+     */
+    std::vector< uint8_t > encode_metadata( std::span< const file_desc_t > descs );
+
+    /**
+     * @brief Encrypt only the used slots of the metadata block for every entry of the table, in table order
+     *
+     * The rest of the block is nothing but the key pattern, `append_metadata_tail` writes it.
+     */
+    std::vector< uint8_t > encode_metadata_slots( const file_table& files );
+
+    /**
+     * @brief Complete the metadata block at `metadata_offset` by appending the key pattern from the end of the file up to the block end
+     *
+     * The pattern comes from one small buffer. With `share` a 1 MB stretch of it is written once and the rest of the block is
+     * cloned from that stretch where the file system supports reflinks (`FICLONERANGE` on Linux), so the empty slots take
+     * almost no disk space but read back byte for byte the same. Everywhere else the pattern is written out.
+     *
+     * @param path Package file, anything written through other streams must be flushed already
+     */
+    std::expected< void, std::string > append_metadata_tail( const std::filesystem::path& path, uint64_t metadata_offset, bool share );
+
+    /**
+     * @brief Parse an encrypted metadata block that is already in memory, e.g. mapped
+     *
+     * The block is split into slot-aligned stripes that are scanned in parallel, empty slots are
+     * recognized from their encrypted hash so only occupied descriptors get decrypted. Every stripe is
+     * scanned, the table is sparse and an empty slot says nothing about the slots after it.
+     *
+     * @param metadata The `kMetadataSize` block, it is not modified
+     * @param concurrency Number of worker threads, 0 means one per hardware thread
+     * @return Occupied descriptors in slot order
+     */
+    file_table decode_metadata( std::span< const uint8_t > metadata, size_t concurrency = 0 );
+
+    /**
+     * @brief Same as above, each stripe is read with its own positional read
+     * @param handle Package file
+     * @param metadata_offset Offset of the metadata block in the file
+     */
+    std::expected< file_table, std::string > decode_metadata( const file_handle& handle, uint64_t metadata_offset, size_t concurrency = 0 );
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include <kspkg-core/patch_builder.hpp>
+#include <kspkg-core/cipher.hpp>
+
+#include "metadata.hpp"
+#include "patch_format.hpp"
+#include "sidecar.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <system_error>
+
+namespace kspkg {
+
+    namespace {
+
+        constexpr size_t kCommitBufferSize = 0x800000; // 8 MB, small files are gathered into writes of this size
+        constexpr uint64_t kInPlaceLimit = 0x4000000;  // 64 MB, larger updates are held in memory for no gain and go appended
+
+        struct location_t {
+            file entry;
+            uint64_t offset = 0;
+            uint64_t size = 0;
+        };
+
+    } // namespace
+
+    size_t patch_builder::stage( const std::vector< std::filesystem::path >& new_filespathes, const std::filesystem::path& new_files_root_dir ) {
+        size_t staged = 0;
+
+        for ( const auto& new_filepath : new_filespathes ) {
+            const auto virtual_full_filename = new_files_root_dir / new_filepath.filename().string();
+
+            if ( const auto entry = package_->find( virtual_full_filename.string() ); entry && stage( entry, new_filepath ) ) {
+                staged += 1;
+            }
+        }
+
+        return staged;
+    }
+
+    bool patch_builder::stage( const file& entry, const std::filesystem::path& new_filepath ) {
+        if ( !entry || entry.is_directory() ) {
+            return false;
+        }
+
+        std::error_code ec;
+        const uint64_t size = std::filesystem::file_size( new_filepath, ec );
+        if ( ec ) {
+            return false;
+        }
+
+        if ( const auto it = positions_.find( entry.get_index() ); it != positions_.end() ) {
+            staged_[ it->second ] = { entry, new_filepath, size };
+        }
+        else {
+            positions_.emplace( entry.get_index(), staged_.size() );
+            staged_.push_back( { entry, new_filepath, size } );
+        }
+
+        return true;
+    }
+
+    uint64_t patch_builder::staged_bytes() const noexcept {
+        uint64_t bytes = 0;
+        for ( const auto& staged : staged_ )
+            bytes += staged.size;
+
+        return bytes;
+    }
+
+    void patch_builder::clear() {
+        staged_.clear();
+        positions_.clear();
+    }
+
+    expected< void > patch_builder::commit( const patch_options_t& options ) {
+        if ( staged_.empty() ) {
+            return {};
+        }
+
+        const auto in_place = commit_in_place();
+        if ( !in_place ) {
+            return unexpected( in_place.error() );
+        }
+
+        if ( !*in_place ) {
+            if ( const auto appended = commit_appended( options ); !appended ) {
+                return appended;
+            }
+        }
+
+        clear();
+        return {};
+    }
+
+    expected< bool > patch_builder::commit_in_place() {
+        const auto& package_path = package_->get_path();
+
+        std::error_code ec;
+        const uint64_t package_size = std::filesystem::file_size( package_path, ec );
+        if ( ec || package_size < kMetadataSize ) {
+            return false;
+        }
+
+        const uint64_t metadata_offset = package_size - kMetadataSize;
+        uint64_t first_offset = metadata_offset;
+
+        for ( const auto& [ entry, source, size ] : staged_ ) {
+            if ( size > entry.get_file_size() || entry.get_index() >= kMaxFileCount ||
+                 entry.get_file_offset() + entry.get_file_size() > metadata_offset ) {
+                return false;
+            }
+
+            first_offset = std::min< uint64_t >( first_offset, entry.get_file_offset() );
+        }
+
+        // The newest patch has to start in front of all overwritten data, older data is what `remove_patches` restores.
+        // Without a footer the marker is only scanned for across the overwritten range
+        const auto patch_position = detail::find_newest_patch(
+            package_path, package_size, std::min( detail::kPatchScanLimit, metadata_offset - first_offset + detail::kPatchMarker.size() ) );
+        if ( !patch_position ) {
+            return unexpected( patch_position.error() );
+        }
+
+        if ( !*patch_position || **patch_position + detail::kPatchMarker.size() > first_offset ) {
+            return false;
+        }
+
+        std::fstream fs( package_path, std::ios::binary | std::ios::in | std::ios::out );
+        if ( !fs.is_open() ) {
+            return unexpected( "Failed to open the package file for writing." );
+        }
+
+        // Slots follow table positions in blocks written by `encode_metadata_slots`, the stored descriptor confirms it
+        std::vector< file_desc_t > descs( staged_.size() );
+        for ( size_t i = 0; i < staged_.size(); i++ ) {
+            const auto& entry = staged_[ i ].entry;
+            auto& desc = descs[ i ];
+
+            fs.seekg( static_cast< std::streamoff >( metadata_offset + entry.get_index() * sizeof( file_desc_t ) ), std::ios::beg );
+            fs.read( reinterpret_cast< char* >( &desc ), sizeof( desc ) );
+            if ( !fs ) {
+                return unexpected( "Failed to read the package metadata." );
+            }
+
+            detail::encrypt_decrypt_data( { reinterpret_cast< uint8_t* >( &desc ), sizeof( desc ) }, kXorKey );
+            if ( desc.file_hash != entry.get_file_hash() || desc.file_offset != entry.get_file_offset() ||
+                 desc.file_size != entry.get_file_size() ) {
+                return false;
+            }
+        }
+
+        // Every source is read and encrypted before the package is touched, anything unexpected leaves it to the append path
+        uint64_t total_size = 0;
+        for ( const auto& staged : staged_ ) {
+            total_size += staged.size;
+        }
+
+        if ( total_size > kInPlaceLimit ) {
+            return false;
+        }
+
+        std::vector< std::vector< uint8_t > > contents( staged_.size() );
+        for ( size_t i = 0; i < staged_.size(); i++ ) {
+            const auto& [ entry, source, size ] = staged_[ i ];
+            auto& content = contents[ i ];
+
+            std::ifstream input( source, std::ios::binary );
+            content.resize( static_cast< size_t >( size ) );
+            input.read( reinterpret_cast< char* >( content.data() ), static_cast< std::streamsize >( content.size() ) );
+
+            // The file has to have exactly the staged size, shorter or longer means it changed since `stage`
+            if ( !input.is_open() || static_cast< size_t >( input.gcount() ) != content.size() ||
+                 input.peek() != std::ifstream::traits_type::eof() ) {
+                return false;
+            }
+
+            if ( entry.is_encrypted() ) {
+                detail::encrypt_decrypt_data( content, kXorKey );
+            }
+        }
+
+        // The overwritten bytes are kept, so a failed write puts the package back the way it was
+        std::vector< std::vector< uint8_t > > previous( staged_.size() );
+        for ( size_t i = 0; i < staged_.size(); i++ ) {
+            previous[ i ].resize( contents[ i ].size() );
+
+            fs.seekg( static_cast< std::streamoff >( staged_[ i ].entry.get_file_offset() ), std::ios::beg );
+            fs.read( reinterpret_cast< char* >( previous[ i ].data() ), static_cast< std::streamsize >( previous[ i ].size() ) );
+            if ( !fs ) {
+                return false;
+            }
+        }
+
+        const auto slot_position = [ & ]( size_t i ) {
+            return static_cast< std::streamoff >( metadata_offset + staged_[ i ].entry.get_index() * sizeof( file_desc_t ) );
+        };
+
+        // Descriptors are 0x100 bytes, so every slot starts at the same key phase as the block
+        const auto write_desc = [ & ]( size_t i, file_desc_t desc ) {
+            detail::encrypt_decrypt_data( { reinterpret_cast< uint8_t* >( &desc ), sizeof( desc ) }, kXorKey );
+
+            fs.seekp( slot_position( i ), std::ios::beg );
+            fs.write( reinterpret_cast< const char* >( &desc ), sizeof( desc ) );
+        };
+
+        const auto write_all = [ & ]( const std::vector< std::vector< uint8_t > >& data, bool patched ) {
+            for ( size_t i = 0; i < staged_.size(); i++ ) {
+                fs.seekp( static_cast< std::streamoff >( staged_[ i ].entry.get_file_offset() ), std::ios::beg );
+                fs.write( reinterpret_cast< const char* >( data[ i ].data() ), static_cast< std::streamsize >( data[ i ].size() ) );
+
+                auto desc = descs[ i ];
+                if ( patched ) {
+                    desc.file_size = staged_[ i ].size;
+                }
+                write_desc( i, desc );
+            }
+
+            fs.flush();
+            return fs.good();
+        };
+
+        // The in-place update keeps the size of the package, the sidecar cannot tell it is stale
+        std::filesystem::remove( detail::sidecar_path( package_path ), ec );
+
+        if ( !write_all( contents, true ) ) {
+            fs.clear();
+            if ( !write_all( previous, false ) ) {
+                return unexpected( "Failed to write the package file, restoring the overwritten data failed too." );
+            }
+
+            return false;
+        }
+
+        for ( const auto& [ entry, source, size ] : staged_ ) {
+            package_->set_file_location( entry, entry.get_file_offset(), size );
+        }
+
+        return true;
+    }
+
+    expected< void > patch_builder::commit_appended( const patch_options_t& options ) {
+        const auto& package_path = package_->get_path();
+
+        std::error_code ec;
+        const uint64_t original_size = std::filesystem::file_size( package_path, ec );
+        if ( ec ) {
+            return unexpected( "Failed to read the package file size." );
+        }
+
+        std::ofstream fs( package_path, std::ios::binary | std::ios::app );
+        if ( !fs.is_open() ) {
+            return unexpected( "Failed to open the package file for writing." );
+        }
+
+        std::vector< location_t > previous;
+        previous.reserve( staged_.size() );
+
+        // Leave the package exactly as it was before the commit
+        const auto roll_back = [ & ]( std::string message ) -> expected< void > {
+            fs.close();
+            for ( const auto& [ entry, offset, size ] : previous ) {
+                package_->set_file_location( entry, offset, size );
+            }
+
+            std::error_code resize_ec;
+            std::filesystem::resize_file( package_path, original_size, resize_ec );
+            return unexpected( std::move( message ) );
+        };
+
+        const auto buffer = std::make_unique_for_overwrite< uint8_t[] >( kCommitBufferSize );
+        size_t filled = 0;
+
+        const auto flush = [ & ] {
+            fs.write( reinterpret_cast< const char* >( buffer.get() ), static_cast< std::streamsize >( filled ) );
+            filled = 0;
+            return fs.good();
+        };
+
+        // Link the new patch to the footer of the current newest one
+        detail::patch_footer_t footer { .patch_offset = original_size,
+                                        .created = std::chrono::duration_cast< std::chrono::seconds >(
+                                                       std::chrono::system_clock::now().time_since_epoch() )
+                                                       .count() };
+
+        if ( original_size >= kMetadataSize + sizeof( detail::patch_footer_t ) ) {
+            std::ifstream input( package_path, std::ios::binary );
+            if ( input.is_open() && detail::read_patch_footer( input, detail::newest_footer_position( original_size ) ) ) {
+                footer.previous_footer = detail::newest_footer_position( original_size );
+            }
+        }
+
+        // One marker for the whole patch, followed by the data of every staged file back to back
+        std::ranges::copy( detail::kPatchMarker, buffer.get() );
+        filled = detail::kPatchMarker.size();
+        uint64_t offset = original_size + detail::kPatchMarker.size();
+
+        for ( const auto& [ entry, source, size ] : staged_ ) {
+            std::ifstream input( source, std::ios::binary );
+            if ( !input.is_open() ) {
+                return roll_back( "Failed to open the new file: " + source.string() );
+            }
+
+            for ( uint64_t done = 0; done < size; ) {
+                if ( filled == kCommitBufferSize && !flush() ) {
+                    return roll_back( "Failed to write the package file." );
+                }
+
+                const auto length = static_cast< size_t >( std::min< uint64_t >( kCommitBufferSize - filled, size - done ) );
+                input.read( reinterpret_cast< char* >( buffer.get() + filled ), static_cast< std::streamsize >( length ) );
+                if ( static_cast< size_t >( input.gcount() ) != length ) {
+                    return roll_back( "The new file changed while patching: " + source.string() );
+                }
+
+                if ( entry.is_encrypted() ) {
+                    // Keep the key phase aligned with the position inside the file
+                    detail::encrypt_decrypt_data( { buffer.get() + filled, length }, detail::key_at_offset( kXorKey, done ) );
+                }
+
+                filled += length;
+                done += length;
+            }
+
+            previous.push_back( { entry, entry.get_file_offset(), entry.get_file_size() } );
+            package_->set_file_location( entry, offset, size );
+            offset += size;
+        }
+
+        // The footer sits right in front of the metadata, where `remove_patches` looks for it
+        if ( filled + sizeof( footer ) > kCommitBufferSize && !flush() ) {
+            return roll_back( "Failed to write the package file." );
+        }
+
+        detail::seal_patch_footer( footer, offset );
+        std::memcpy( buffer.get() + filled, &footer, sizeof( footer ) );
+        filled += sizeof( footer );
+
+        if ( !flush() ) {
+            return roll_back( "Failed to write the package file." );
+        }
+
+        // Just push metadata to the end of the file without care about old metadata, only the used slots take a buffer
+        const auto slots = detail::encode_metadata_slots( package_->get_files() );
+        fs.write( reinterpret_cast< const char* >( slots.data() ), static_cast< std::streamsize >( slots.size() ) );
+        fs.flush();
+        if ( !fs ) {
+            return roll_back( "Failed to write the package metadata." );
+        }
+
+        if ( const auto tail = detail::append_metadata_tail( package_path, offset + sizeof( footer ), options.share_metadata_tail ); !tail ) {
+            return roll_back( tail.error() );
+        }
+
+        return {};
+    }
+
+} // namespace kspkg
@@ -0,0 +1,208 @@
+#include "patch_format.hpp"
+
+#include "hash.hpp"
+#include "metadata.hpp"
+
+#include <kspkg-core/cipher.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <vector>
+
+namespace kspkg::detail {
+
+    namespace {
+
+        constexpr uint64_t kScanBlockSize = 0x100000; // 1 MB, the scan stops at the first block holding a marker
+        constexpr size_t kProbeSlots = 0x800;          // 512 KB of slots checked before the whole block is decoded
+
+        uint64_t footer_checksum( const patch_footer_t& footer, uint64_t position ) noexcept {
+            const auto fields = std::span( reinterpret_cast< const uint8_t* >( &footer ), offsetof( patch_footer_t, checksum ) );
+            const auto where = std::span( reinterpret_cast< const uint8_t* >( &position ), sizeof( position ) );
+
+            return fnv1a( where, fnv1a( fields, kFnvOffsetBasis ^ kXorKey ) );
+        }
+
+        /**
+         * @brief Read any footer whose checksum matches `position`
+         */
+        std::optional< patch_footer_t > read_footer( std::istream& input, uint64_t position ) {
+            patch_footer_t footer;
+
+            input.clear();
+            input.seekg( static_cast< std::streamoff >( position ), std::ios::beg );
+            input.read( reinterpret_cast< char* >( &footer ), sizeof( footer ) );
+
+            // A short read leaves the stream usable for the caller
+            const bool read = static_cast< bool >( input );
+            input.clear();
+
+            if ( !read || footer.checksum != footer_checksum( footer, position ) ) {
+                return std::nullopt;
+            }
+
+            return footer;
+        }
+
+    } // namespace
+
+    void seal_patch_footer( patch_footer_t& footer, uint64_t position ) noexcept {
+        footer.checksum = footer_checksum( footer, position );
+    }
+
+    std::optional< patch_footer_t > read_patch_footer( std::istream& input, uint64_t position ) {
+        const auto footer = read_footer( input, position );
+        if ( !footer || footer->magic != kPatchFooterMagic || footer->patch_offset >= position ) {
+            return std::nullopt;
+        }
+
+        return footer;
+    }
+
+    patch_footer_t make_base_footer( uint64_t position ) {
+        patch_footer_t footer { .magic = kBaseFooterMagic,
+                                .created = std::chrono::duration_cast< std::chrono::seconds >(
+                                               std::chrono::system_clock::now().time_since_epoch() )
+                                               .count() };
+
+        seal_patch_footer( footer, position );
+        return footer;
+    }
+
+    bool is_base_footer( std::istream& input, uint64_t position ) {
+        const auto footer = read_footer( input, position );
+        return footer && footer->magic == kBaseFooterMagic;
+    }
+
+    expected< std::optional< uint64_t > > find_patch_marker( const std::filesystem::path& path, uint64_t end, uint64_t length ) {
+        std::ifstream input( path, std::ios::binary );
+        if ( !input.is_open() ) {
+            return unexpected( "Failed to open the package file for reading." );
+        }
+
+        const uint64_t begin = end - std::min( length, end );
+        std::vector< uint8_t > buffer( kScanBlockSize + kPatchMarker.size() - 1 );
+
+        for ( uint64_t block_end = end; block_end > begin; ) {
+            const uint64_t block_begin = block_end - std::min( kScanBlockSize, block_end - begin );
+
+            // Overlap the following block, so a marker split between two blocks is still found
+            const auto read_size = static_cast< size_t >( std::min( end, block_end + kPatchMarker.size() - 1 ) - block_begin );
+
+            input.seekg( static_cast< std::streamoff >( block_begin ), std::ios::beg );
+            input.read( reinterpret_cast< char* >( buffer.data() ), static_cast< std::streamsize >( read_size ) );
+            if ( static_cast< size_t >( input.gcount() ) != read_size ) {
+                return unexpected( "Failed to read the package file." );
+            }
+
+            const auto data = std::span( buffer ).first( read_size );
+            if ( const auto it = std::search( data.rbegin(), data.rend(), kPatchMarker.rbegin(), kPatchMarker.rend() ); it != data.rend() ) {
+                return block_begin + static_cast< uint64_t >( data.rend() - it ) - kPatchMarker.size();
+            }
+
+            block_end = block_begin;
+        }
+
+        return std::nullopt;
+    }
+
+    expected< bool > is_patch_start( const std::filesystem::path& path, uint64_t position ) {
+        if ( position < kMetadataSize ) {
+            return false;
+        }
+
+        const uint64_t metadata_offset = position - kMetadataSize;
+        const auto handle = file_handle::open( path );
+        if ( !handle ) {
+            return unexpected( handle.error() );
+        }
+
+        // Slots may be empty anywhere, but every occupied one has to point in front of the block. Bytes that only happen to
+        // precede a marker fail this on their first slots, before the whole block is read
+        std::vector< file_desc_t > probe( kProbeSlots );
+        const std::span< uint8_t > probe_bytes( reinterpret_cast< uint8_t* >( probe.data() ), probe.size() * sizeof( file_desc_t ) );
+        if ( !handle->read_at( metadata_offset, probe_bytes ) ) {
+            return unexpected( "Failed to read the package file." );
+        }
+
+        encrypt_decrypt_data( probe_bytes, kXorKey );
+        for ( const auto& desc : probe ) {
+            if ( desc.file_hash != 0 && ( desc.file_offset > metadata_offset || desc.file_size > metadata_offset - desc.file_offset ) ) {
+                return false;
+            }
+        }
+
+        const auto files = decode_metadata( *handle, metadata_offset );
+        if ( !files ) {
+            return unexpected( files.error() );
+        }
+
+        if ( files->size() == 0 ) {
+            return false;
+        }
+
+        for ( size_t i = 0; i < files->size(); i++ ) {
+            const uint64_t offset = files->offsets()[ i ];
+            const uint64_t size = files->sizes()[ i ];
+            if ( offset > metadata_offset || size > metadata_offset - offset ) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    expected< std::optional< uint64_t > > find_newest_patch( const std::filesystem::path& path, uint64_t package_size,
+                                                             uint64_t scan_length ) {
+        if ( package_size < kMetadataSize ) {
+            return std::nullopt;
+        }
+
+        if ( package_size >= kMetadataSize + sizeof( patch_footer_t ) ) {
+            std::ifstream input( path, std::ios::binary );
+            if ( !input.is_open() ) {
+                return unexpected( "Failed to open the package file for reading." );
+            }
+
+            if ( const auto footer = read_patch_footer( input, newest_footer_position( package_size ) ) ) {
+                return footer->patch_offset;
+            }
+
+            if ( is_base_footer( input, newest_footer_position( package_size ) ) ) {
+                return std::nullopt;
+            }
+        }
+
+        // Patches written before footers existed are only found by their marker, entry data may hold the same bytes
+        const uint64_t metadata_offset = package_size - kMetadataSize;
+        const uint64_t begin = metadata_offset - std::min( scan_length, metadata_offset );
+
+        for ( uint64_t end = metadata_offset; end > begin; ) {
+            const auto marker = find_patch_marker( path, end, end - begin );
+            if ( !marker ) {
+                return unexpected( marker.error() );
+            }
+
+            if ( !*marker ) {
+                break;
+            }
+
+            const auto valid = is_patch_start( path, **marker );
+            if ( !valid ) {
+                return unexpected( valid.error() );
+            }
+
+            if ( *valid ) {
+                return *marker;
+            }
+
+            // The marker cannot overlap itself, so the next one ends in front of the last byte of this one
+            end = **marker + kPatchMarker.size() - 1;
+        }
+
+        return std::nullopt;
+    }
+
+} // namespace kspkg::detail
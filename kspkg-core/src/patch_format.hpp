@@ -0,0 +1,98 @@
+#pragma once
+
+#include <kspkg-core/core.hpp>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <optional>
+
+namespace kspkg::detail {
+
+    /**
+     * @brief Written in front of the data of every patch, `remove_patches` truncates the package back to it
+     */
+    constexpr std::array< uint8_t, 5 > kPatchMarker = { 0x31, 0x32, 0x33, 0x34, 0x35 };
+
+    constexpr uint64_t kPatchScanLimit = 0x10000000; // 256 MB, markers further from the end are not looked for
+
+    constexpr uint64_t kPatchFooterMagic = 0x3148435441505346; // "FSPATCH1"
+    constexpr uint64_t kBaseFooterMagic = 0x3130455341425346;  // "FSBASE01"
+    constexpr uint64_t kNoPatchFooter = ~0ull;
+
+    /**
+     * @brief Written right in front of the metadata block of every patch
+     *
+     * Footers link to the footer of the previous patch, so every patch boundary is found with one small read per patch.
+     * The checksum is keyed and covers the position of the footer, entry data that looks like a footer is not taken for one.
+     *
+     * A footer with `kBaseFooterMagic` seals a package written from scratch, e.g. by `compact_package`. Everything in front of
+     * it is base data, so there is no patch below it to remove or scan for.
+     */
+    struct patch_footer_t {
+        uint64_t magic = kPatchFooterMagic;
+        uint64_t patch_offset = 0;                 // Position of the patch marker, truncating there removes the patch
+        uint64_t previous_footer = kNoPatchFooter; // Position of the footer of the previous patch
+        int64_t created = 0;                       // Seconds since the Unix epoch
+        uint64_t checksum = 0;
+    };
+
+    static_assert( sizeof( patch_footer_t ) == 40, "Footer layout is part of the package format" );
+
+    /**
+     * @brief Position of the footer of the newest patch, right in front of the metadata block
+     */
+    [[nodiscard]] constexpr uint64_t newest_footer_position( uint64_t package_size ) noexcept {
+        return package_size - kMetadataSize - sizeof( patch_footer_t );
+    }
+
+    /**
+     * @brief Fill in the checksum of a footer written at `position`
+     */
+    void seal_patch_footer( patch_footer_t& footer, uint64_t position ) noexcept;
+
+    /**
+     * @brief Read the footer at `position`
+     * @return Nothing when the bytes there are not a valid patch footer written at that position
+     */
+    std::optional< patch_footer_t > read_patch_footer( std::istream& input, uint64_t position );
+
+    /**
+     * @brief Footer that marks the data in front of it as base data
+     */
+    patch_footer_t make_base_footer( uint64_t position );
+
+    /**
+     * @return True when a valid base footer was written at `position`
+     */
+    bool is_base_footer( std::istream& input, uint64_t position );
+
+    /**
+     * @brief Find the newest patch marker by scanning backwards from `end`, for patches written without a footer
+     * @param path Package file
+     * @param end End of the scanned range, exclusive
+     * @param length Bytes scanned before `end` at most
+     * @return Position of the last marker in the range, or nothing when the range holds none
+     */
+    expected< std::optional< uint64_t > > find_patch_marker( const std::filesystem::path& path, uint64_t end, uint64_t length );
+
+    /**
+     * @brief Check that a marker found by scanning really starts a patch
+     *
+     * Patches written without a footer follow the metadata block of the package they patched, so a decodable block has to end
+     * exactly at the marker and describe only data in front of it. Entry data that merely contains the marker bytes does not.
+     */
+    expected< bool > is_patch_start( const std::filesystem::path& path, uint64_t position );
+
+    /**
+     * @brief Position of the newest patch, read from its footer or found by scanning for a marker that passes `is_patch_start`
+     *
+     * A package sealed with a base footer has no patch, nothing is scanned then.
+     * @param scan_length Bytes in front of the newest metadata block scanned at most when there is no footer
+     * @return Nothing when the package has no patch
+     */
+    expected< std::optional< uint64_t > > find_newest_patch( const std::filesystem::path& path, uint64_t package_size,
+                                                             uint64_t scan_length = kPatchScanLimit );
+
+} // namespace kspkg::detail
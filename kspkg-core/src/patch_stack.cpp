@@ -0,0 +1,136 @@
+#include <kspkg-core/patch_stack.hpp>
+#include <kspkg-core/file_handle.hpp>
+
+#include "metadata.hpp"
+#include "patch_format.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+namespace kspkg {
+
+    namespace {
+
+        /**
+         * @brief Entries whose location differs from the previous generation, matched by path hash
+         */
+        std::vector< std::string > diff_generations( const file_table& previous, const file_table& current ) {
+            std::unordered_map< uint64_t, std::pair< uint64_t, uint64_t > > locations;
+            locations.reserve( previous.size() );
+            for ( const auto entry : previous ) {
+                locations.emplace( entry.get_file_hash(), std::pair< uint64_t, uint64_t > { entry.get_file_offset(), entry.get_file_size() } );
+            }
+
+            std::vector< std::string > touched;
+            for ( const auto entry : current ) {
+                const auto it = locations.find( entry.get_file_hash() );
+                if ( it == locations.end() || it->second != std::pair< uint64_t, uint64_t > { entry.get_file_offset(), entry.get_file_size() } ) {
+                    touched.emplace_back( entry.get_name() );
+                }
+            }
+
+            return touched;
+        }
+
+    } // namespace
+
+    expected< std::vector< patch_generation_t > > list_patches( const std::shared_ptr< package >& package, bool touched_entries ) {
+        const auto& package_path = package->get_path();
+
+        std::error_code ec;
+        const uint64_t package_size = std::filesystem::file_size( package_path, ec );
+        if ( ec ) {
+            return unexpected( "Failed to read the package file size." );
+        }
+
+        if ( package_size < kMetadataSize ) {
+            return unexpected( "Package file is too small." );
+        }
+
+        std::ifstream input( package_path, std::ios::binary );
+        if ( !input.is_open() ) {
+            return unexpected( "Failed to open the package file for reading." );
+        }
+
+        // Walk the footers from the newest patch down, each one ends right where the next one's metadata starts
+        std::vector< patch_generation_t > generations;
+        uint64_t generation_end = package_size;
+
+        while ( generation_end >= kMetadataSize + sizeof( detail::patch_footer_t ) ) {
+            const uint64_t position = detail::newest_footer_position( generation_end );
+            const auto footer = detail::read_patch_footer( input, position );
+            if ( !footer ) {
+                break;
+            }
+
+            generations.push_back( { footer->patch_offset, generation_end - footer->patch_offset, footer->created, {} } );
+            generation_end = footer->patch_offset;
+
+            // A chain that does not line up with the generation below ends here
+            if ( footer->previous_footer == detail::kNoPatchFooter || generation_end < kMetadataSize + sizeof( detail::patch_footer_t ) ||
+                 footer->previous_footer != detail::newest_footer_position( generation_end ) ) {
+                break;
+            }
+        }
+
+        generations.push_back( { 0, generation_end, 0, {} } );
+        std::ranges::reverse( generations );
+
+        if ( !touched_entries || generations.size() == 1 ) {
+            return generations;
+        }
+
+        auto handle = detail::file_handle::open( package_path );
+        if ( !handle ) {
+            return unexpected( handle.error() );
+        }
+
+        // Every generation ends with its metadata block, neighbours are diffed two blocks at a time
+        auto previous = detail::decode_metadata( *handle, generations[ 0 ].size - kMetadataSize );
+        if ( !previous ) {
+            return unexpected( previous.error() );
+        }
+
+        for ( size_t i = 1; i < generations.size(); i++ ) {
+            auto& generation = generations[ i ];
+
+            auto current = detail::decode_metadata( *handle, generation.offset + generation.size - kMetadataSize );
+            if ( !current ) {
+                return unexpected( current.error() );
+            }
+
+            generation.touched = diff_generations( *previous, *current );
+            previous = std::move( current );
+        }
+
+        return generations;
+    }
+
+    expected< void > roll_back_patches( const std::shared_ptr< package >& package, size_t generation ) {
+        const auto generations = list_patches( package, false );
+        if ( !generations ) {
+            return unexpected( generations.error() );
+        }
+
+        if ( generation >= generations->size() ) {
+            return unexpected( "The package has no patch generation " + std::to_string( generation ) + "." );
+        }
+
+        const auto& kept = ( *generations )[ generation ];
+        if ( generation + 1 == generations->size() ) {
+            return {};
+        }
+
+        std::error_code ec;
+        std::filesystem::resize_file( package->get_path(), kept.offset + kept.size, ec );
+        if ( ec ) {
+            return unexpected( "Failed to truncate the package file: " + ec.message() );
+        }
+
+        return {};
+    }
+
+} // namespace kspkg
@@ -0,0 +1,107 @@
+#include <kspkg-core/path_index.hpp>
+
+#include "hash.hpp"
+#include "serialization.hpp"
+
+#include <bit>
+
+namespace kspkg::detail {
+
+    std::string normalize_path( std::string_view path, bool case_insensitive ) {
+        std::string result;
+        result.reserve( path.size() );
+
+        for ( const char c : path ) {
+            if ( c == '/' || c == '\\' ) {
+                // Collapse to one `/`, leading separators are dropped
+                if ( !result.empty() && result.back() != '/' )
+                    result.push_back( '/' );
+            }
+            else if ( case_insensitive && c >= 'A' && c <= 'Z' ) {
+                result.push_back( static_cast< char >( c - 'A' + 'a' ) );
+            }
+            else {
+                result.push_back( c );
+            }
+        }
+
+        if ( !result.empty() && result.back() == '/' )
+            result.pop_back();
+
+        return result;
+    }
+
+    path_index::path_index( const file_table& files, bool case_insensitive ) : case_insensitive_( case_insensitive ) {
+        // Keep the load factor at or below one half
+        slots_.assign( std::bit_ceil( files.size() * 2 + 1 ), 0 );
+        hashes_.resize( files.size() );
+
+        const auto mask = slots_.size() - 1;
+
+        for ( size_t i = 0; i < files.size(); i++ ) {
+            const auto normalized = normalize_path( files.name( i ), case_insensitive_ );
+            hashes_[ i ] = fnv1a( normalized );
+
+            if ( find_normalized( files, normalized, hashes_[ i ] ) != kNotFound )
+                continue;
+
+            auto slot = hashes_[ i ] & mask;
+            while ( slots_[ slot ] != 0 ) {
+                slot = ( slot + 1 ) & mask;
+            }
+            slots_[ slot ] = static_cast< uint32_t >( i + 1 );
+        }
+    }
+
+    uint32_t path_index::find( const file_table& files, std::string_view path ) const {
+        if ( slots_.empty() )
+            return kNotFound;
+
+        const auto normalized = normalize_path( path, case_insensitive_ );
+        return find_normalized( files, normalized, fnv1a( normalized ) );
+    }
+
+    uint32_t path_index::find_normalized( const file_table& files, std::string_view normalized, uint64_t hash ) const {
+        const auto mask = slots_.size() - 1;
+
+        for ( auto slot = hash & mask; slots_[ slot ] != 0; slot = ( slot + 1 ) & mask ) {
+            const auto position = slots_[ slot ] - 1;
+            if ( hashes_[ position ] == hash && normalize_path( files.name( position ), case_insensitive_ ) == normalized )
+                return position;
+        }
+
+        return kNotFound;
+    }
+
+    void path_index::serialize( std::vector< uint8_t >& out ) const {
+        out.push_back( case_insensitive_ ? 1 : 0 );
+        write_array< uint64_t >( out, hashes_ );
+        write_array< uint32_t >( out, slots_ );
+    }
+
+    bool path_index::deserialize( std::span< const uint8_t >& data, size_t entry_count ) {
+        if ( data.empty() )
+            return false;
+
+        case_insensitive_ = data[ 0 ] != 0;
+        data = data.subspan( 1 );
+
+        if ( !read_array( data, hashes_ ) || !read_array( data, slots_ ) )
+            return false;
+
+        if ( hashes_.size() != entry_count || !std::has_single_bit( slots_.size() ) || slots_.size() <= entry_count )
+            return false;
+
+        // Every entry sits in at most one slot, so fewer slots are taken than exist and every probe ends at an empty one
+        std::vector< bool > seen( entry_count + 1 );
+        for ( const auto slot : slots_ ) {
+            if ( slot > entry_count || ( slot != 0 && seen[ slot ] ) )
+                return false;
+
+            seen[ slot ] = true;
+        }
+
+        return true;
+    }
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace kspkg::detail {
+
+    /**
+     * @brief Append a count-prefixed array of trivially copyable values in native byte order
+     */
+    template < typename T >
+    void write_array( std::vector< uint8_t >& out, std::span< const T > values ) {
+        const uint64_t count = values.size();
+        const auto* count_bytes = reinterpret_cast< const uint8_t* >( &count );
+        const auto* value_bytes = reinterpret_cast< const uint8_t* >( values.data() );
+
+        out.insert( out.end(), count_bytes, count_bytes + sizeof( count ) );
+        out.insert( out.end(), value_bytes, value_bytes + values.size_bytes() );
+    }
+
+    /**
+     * @brief Read an array written by `write_array` and advance `data` past it
+     * @return False when `data` is too short
+     */
+    template < typename T >
+    bool read_array( std::span< const uint8_t >& data, std::vector< T >& values ) {
+        uint64_t count;
+        if ( data.size() < sizeof( count ) )
+            return false;
+
+        std::memcpy( &count, data.data(), sizeof( count ) );
+        data = data.subspan( sizeof( count ) );
+
+        if ( count > data.size() / sizeof( T ) )
+            return false;
+
+        values.resize( count );
+        std::memcpy( values.data(), data.data(), count * sizeof( T ) );
+        data = data.subspan( count * sizeof( T ) );
+
+        return true;
+    }
+
+} // namespace kspkg::detail
\ No newline at end of file
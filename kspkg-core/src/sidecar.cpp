@@ -0,0 +1,161 @@
+#include "sidecar.hpp"
+
+#include "hash.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <kspkg-core/mapped_file.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <system_error>
+
+namespace kspkg::detail {
+
+    namespace {
+
+        constexpr char kSidecarMagic[ 8 ] = { 'K', 'S', 'P', 'K', 'G', 'I', 'D', 'X' };
+        constexpr uint32_t kByteOrderMark = 0x01020304; // Sidecars are native-endian, reject foreign ones
+
+        constexpr size_t kHashPieceSize = 0x100000; // 1 MB of the metadata block per hashed piece
+
+        struct sidecar_header_t {
+            char magic[ 8 ];
+            uint32_t version;
+            uint32_t byte_order;
+            sidecar_key_t key;
+        };
+
+        /**
+         * @brief FNV-1a over 8-byte words spread over four lanes, so the multiplications do not wait on each other
+         */
+        uint64_t hash_piece( std::span< const uint8_t > piece ) noexcept {
+            std::array< uint64_t, 4 > lanes;
+            lanes.fill( kFnvOffsetBasis );
+
+            for ( size_t offset = 0; offset + sizeof( lanes ) <= piece.size(); offset += sizeof( lanes ) ) {
+                for ( size_t lane = 0; lane < lanes.size(); lane++ ) {
+                    uint64_t word;
+                    std::memcpy( &word, piece.data() + offset + lane * sizeof( word ), sizeof( word ) );
+                    lanes[ lane ] = ( lanes[ lane ] ^ word ) * 0x100000001B3;
+                }
+            }
+
+            return fnv1a( std::span( reinterpret_cast< const uint8_t* >( lanes.data() ), sizeof( lanes ) ) );
+        }
+
+        /**
+         * @brief Hash every piece with `hash( piece )` in parallel and join the piece hashes in block order
+         */
+        template < typename hash_t >
+        uint64_t hash_pieces( size_t concurrency, hash_t&& hash ) {
+            std::array< uint64_t, kMetadataSize / kHashPieceSize > pieces {};
+
+            work_stealing_pool pool( std::min( concurrency, pieces.size() ) );
+            pool.parallel_for( pieces.size(), [ & ]( size_t piece ) { pieces[ piece ] = hash( piece ); } );
+
+            return fnv1a( std::span( reinterpret_cast< const uint8_t* >( pieces.data() ), sizeof( pieces ) ) );
+        }
+
+        static_assert( kMetadataSize % kHashPieceSize == 0, "Hashed pieces must cover the metadata block exactly" );
+
+    } // namespace
+
+    uint64_t hash_metadata( std::span< const uint8_t > metadata, size_t concurrency ) {
+        return hash_pieces( concurrency,
+                            [ & ]( size_t piece ) { return hash_piece( metadata.subspan( piece * kHashPieceSize, kHashPieceSize ) ); } );
+    }
+
+    std::expected< uint64_t, std::string > hash_metadata( const file_handle& handle, uint64_t metadata_offset, size_t concurrency ) {
+        std::atomic< bool > read_failed = false;
+
+        const auto hash = hash_pieces( concurrency, [ & ]( size_t piece ) -> uint64_t {
+            const auto buffer = std::make_unique_for_overwrite< uint8_t[] >( kHashPieceSize );
+            const std::span< uint8_t > data( buffer.get(), kHashPieceSize );
+
+            if ( !handle.read_at( metadata_offset + piece * kHashPieceSize, data ) ) {
+                read_failed = true;
+                return 0;
+            }
+
+            return hash_piece( data );
+        } );
+
+        if ( read_failed )
+            return std::unexpected( "Failed to read the package metadata." );
+
+        return hash;
+    }
+
+    std::filesystem::path sidecar_path( const std::filesystem::path& package_path ) {
+        auto path = package_path;
+        path += ".idx";
+        return path;
+    }
+
+    bool read_sidecar( const std::filesystem::path& package_path, const sidecar_key_t& key, bool case_insensitive, file_table& files,
+                       path_index& index ) {
+        const auto mapping = mapped_file::open( sidecar_path( package_path ) );
+        if ( !mapping )
+            return false;
+
+        auto data = mapping->data();
+
+        sidecar_header_t header;
+        if ( data.size() < sizeof( header ) )
+            return false;
+
+        std::memcpy( &header, data.data(), sizeof( header ) );
+        data = data.subspan( sizeof( header ) );
+
+        if ( std::memcmp( header.magic, kSidecarMagic, sizeof( kSidecarMagic ) ) != 0 || header.version != kSidecarVersion ||
+             header.byte_order != kByteOrderMark || !( header.key == key ) )
+            return false;
+
+        if ( !files.deserialize( data ) || !index.deserialize( data, files.size() ) || !data.empty() )
+            return false;
+
+        return index.is_case_insensitive() == case_insensitive;
+    }
+
+    bool write_sidecar( const std::filesystem::path& package_path, const sidecar_key_t& key, const file_table& files,
+                        const path_index& index ) {
+        sidecar_header_t header {};
+        std::memcpy( header.magic, kSidecarMagic, sizeof( kSidecarMagic ) );
+        header.version = kSidecarVersion;
+        header.byte_order = kByteOrderMark;
+        header.key = key;
+
+        std::vector< uint8_t > data( sizeof( header ) );
+        std::memcpy( data.data(), &header, sizeof( header ) );
+        files.serialize( data );
+        index.serialize( data );
+
+        // Write next to the target and rename, so readers never see a partial sidecar
+        const auto path = sidecar_path( package_path );
+        auto temp_path = path;
+        temp_path += ".tmp";
+
+        bool written;
+        {
+            std::ofstream fs( temp_path, std::ios::binary | std::ios::trunc );
+            fs.write( reinterpret_cast< const char* >( data.data() ), static_cast< std::streamsize >( data.size() ) );
+            written = fs.good();
+        }
+
+        std::error_code ec;
+        if ( written )
+            std::filesystem::rename( temp_path, path, ec );
+
+        if ( !written || ec ) {
+            std::filesystem::remove( temp_path, ec );
+            return false;
+        }
+
+        return true;
+    }
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <kspkg-core/file_handle.hpp>
+#include <kspkg-core/file_table.hpp>
+#include <kspkg-core/path_index.hpp>
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string>
+
+namespace kspkg::detail {
+
+    constexpr uint32_t kSidecarVersion = 2;
+
+    /**
+     * @brief State of the package a sidecar was written for, any difference makes the sidecar stale
+     */
+    struct sidecar_key_t {
+        uint64_t package_size = 0;
+        int64_t package_mtime = 0;
+        uint64_t metadata_hash = 0; // `hash_metadata` of the encrypted metadata block
+
+        bool operator==( const sidecar_key_t& ) const = default;
+    };
+
+    /**
+     * @brief Hash of the whole encrypted metadata block
+     *
+     * Any descriptor can change without the package size changing, e.g. through an in-place update, so every slot is covered.
+     * The block is hashed in 1 MB pieces on a worker pool, a word at a time, which keeps 32 MB within a few milliseconds.
+     *
+     * @param metadata The `kMetadataSize` block
+     * @param concurrency Number of worker threads, 0 means one per hardware thread
+     */
+    uint64_t hash_metadata( std::span< const uint8_t > metadata, size_t concurrency = 0 );
+
+    /**
+     * @brief Same as above, each piece is read with its own positional read
+     */
+    std::expected< uint64_t, std::string > hash_metadata( const file_handle& handle, uint64_t metadata_offset, size_t concurrency = 0 );
+
+    /**
+     * @brief Sidecar location for a package, `<package>.idx`
+     */
+    std::filesystem::path sidecar_path( const std::filesystem::path& package_path );
+
+    /**
+     * @brief Restore the entry table and path index from the package sidecar
+     * @return False when the sidecar is missing, stale, written by another version or malformed
+     */
+    bool read_sidecar( const std::filesystem::path& package_path, const sidecar_key_t& key, bool case_insensitive, file_table& files,
+                       path_index& index );
+
+    /**
+     * @brief Write the sidecar next to the package, replacing the old one atomically
+     * @return False when it could not be written, the package stays usable without it
+     */
+    bool write_sidecar( const std::filesystem::path& package_path, const sidecar_key_t& key, const file_table& files,
+                        const path_index& index );
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+
+namespace kspkg::detail {
+
+    work_stealing_pool::work_stealing_pool( size_t concurrency ) {
+        if ( concurrency == 0 )
+            concurrency = std::max( 1u, std::thread::hardware_concurrency() );
+
+        for ( size_t i = 0; i < concurrency; i++ ) {
+            queues_.emplace_back( std::make_unique< queue_t >() );
+        }
+
+        for ( size_t i = 0; i < concurrency; i++ ) {
+            workers_.emplace_back( [ this, i ] { worker_loop( i ); } );
+        }
+    }
+
+    work_stealing_pool::~work_stealing_pool() {
+        {
+            std::lock_guard lock( mutex_ );
+            stopping_ = true;
+        }
+        wake_cv_.notify_all();
+
+        for ( auto& worker : workers_ ) {
+            worker.join();
+        }
+    }
+
+    void work_stealing_pool::parallel_for( size_t count, const std::function< void( size_t ) >& task ) {
+        if ( count == 0 )
+            return;
+
+        std::lock_guard run_lock( run_mutex_ );
+
+        const size_t worker_count = workers_.size();
+        const size_t block = ( count + worker_count - 1 ) / worker_count;
+
+        for ( size_t i = 0; i < worker_count; i++ ) {
+            std::lock_guard lock( queues_[ i ]->mutex );
+            for ( size_t item = i * block; item < std::min( count, ( i + 1 ) * block ); item++ ) {
+                queues_[ i ]->items.push_back( item );
+            }
+        }
+
+        std::unique_lock lock( mutex_ );
+        task_ = &task;
+        active_workers_ = worker_count;
+        generation_++;
+        wake_cv_.notify_all();
+
+        done_cv_.wait( lock, [ this ] { return active_workers_ == 0; } );
+        task_ = nullptr;
+    }
+
+    void work_stealing_pool::worker_loop( size_t worker_index ) {
+        size_t seen_generation = 0;
+
+        while ( true ) {
+            const std::function< void( size_t ) >* task;
+            {
+                std::unique_lock lock( mutex_ );
+                wake_cv_.wait( lock, [ & ] { return stopping_ || generation_ != seen_generation; } );
+                if ( stopping_ )
+                    return;
+
+                seen_generation = generation_;
+                task = task_;
+            }
+
+            size_t item;
+            while ( pop_or_steal( worker_index, item ) ) {
+                ( *task )( item );
+            }
+
+            std::lock_guard lock( mutex_ );
+            if ( --active_workers_ == 0 )
+                done_cv_.notify_one();
+        }
+    }
+
+    bool work_stealing_pool::pop_or_steal( size_t worker_index, size_t& item ) {
+        {
+            auto& own = *queues_[ worker_index ];
+            std::lock_guard lock( own.mutex );
+            if ( !own.items.empty() ) {
+                item = own.items.front();
+                own.items.pop_front();
+                return true;
+            }
+        }
+
+        // Tasks are never added while a batch runs, so one failed sweep means all work is taken
+        for ( size_t i = 1; i < queues_.size(); i++ ) {
+            auto& victim = *queues_[ ( worker_index + i ) % queues_.size() ];
+            std::lock_guard lock( victim.mutex );
+            if ( !victim.items.empty() ) {
+                item = victim.items.back();
+                victim.items.pop_back();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kspkg::detail {
+
+    /**
+     * @brief Fixed-size thread pool where idle workers steal queued tasks from busy ones
+     */
+    class work_stealing_pool {
+    public:
+        /**
+         * @param concurrency Number of workers, 0 means one per hardware thread
+         */
+        explicit work_stealing_pool( size_t concurrency = 0 );
+        ~work_stealing_pool();
+
+        work_stealing_pool( const work_stealing_pool& ) = delete;
+        work_stealing_pool& operator=( const work_stealing_pool& ) = delete;
+
+        [[nodiscard]] size_t size() const noexcept {
+            return workers_.size();
+        }
+
+        /**
+         * @brief Run `task( i )` for every i in [0, count) and wait for all of them
+         *
+         * Each worker is seeded with a contiguous block of indices and walks it in order,
+         * idle workers steal from the far end of other workers' blocks. Concurrent calls are serialized.
+         */
+        void parallel_for( size_t count, const std::function< void( size_t ) >& task );
+
+    private:
+        struct queue_t {
+            std::mutex mutex;
+            std::deque< size_t > items;
+        };
+
+        void worker_loop( size_t worker_index );
+        bool pop_or_steal( size_t worker_index, size_t& item );
+
+        std::vector< std::unique_ptr< queue_t > > queues_;
+        std::vector< std::thread > workers_;
+
+        std::mutex run_mutex_;
+        std::mutex mutex_;
+        std::condition_variable wake_cv_;
+        std::condition_variable done_cv_;
+        const std::function< void( size_t ) >* task_ = nullptr;
+        size_t generation_ = 0;
+        size_t active_workers_ = 0;
+        bool stopping_ = false;
+    };
+
+} // namespace kspkg::detail
\ No newline at end of file
@@ -8,6 +8,6 @@ namespace views {
     class content_processor {
     public:
         virtual ~content_processor() = default;
-        virtual void process( const std::shared_ptr< kspkg::package >& package, const std::shared_ptr< kspkg::file >& file ) = 0;
+        virtual void process( const std::shared_ptr< kspkg::package >& package, const kspkg::file& file ) = 0;
     };
 } // namespace views
@@ -6,25 +6,25 @@
 #include <imgui.h>
 
 namespace views {
-    void image_content_processor::process( const std::shared_ptr< kspkg::package >& package, const std::shared_ptr< kspkg::file >& file ) {
+    void image_content_processor::process( const std::shared_ptr< kspkg::package >& package, const kspkg::file& file ) {
         static ID3D11ShaderResourceView* image = nullptr;
         static std::string old_resource;
         static int width = 0, height = 0;
 
-        if ( old_resource != file->get_name() ) {
+        if ( old_resource != file.get_name() ) {
             if ( image ) {
                 image->Release();
                 image = nullptr;
             }
-            old_resource = file->get_name();
+            old_resource = file.get_name();
         }
 
-        const auto file_content = package->extract_file( file );
-        if ( !file_content )
-            return;
-
         if ( !image ) {
-            ImGui::RenderExtensions::LoadTextureFromMemory( file_content->data(), file_content->size(), &image, &width, &height );
+            const auto file_content = package->extract_cached( file );
+            if ( !file_content )
+                return;
+
+            ImGui::RenderExtensions::LoadTextureFromMemory( ( *file_content )->data(), ( *file_content )->size(), &image, &width, &height );
         }
 
         if ( !image )
@@ -4,7 +4,7 @@
 #include "text_editor/text_editor.hpp"
 
 namespace views {
-    void text_content_processor::process( const std::shared_ptr< kspkg::package >& package, const std::shared_ptr< kspkg::file >& file ) {
+    void text_content_processor::process( const std::shared_ptr< kspkg::package >& package, const kspkg::file& file ) {
         static std::map< std::string, TextEditor::LanguageDefinition > ext_map = {
             { ".html", TextEditor::LanguageDefinition::HTML() },
             { ".loc", TextEditor::LanguageDefinition::HTML() },
@@ -19,13 +19,13 @@ namespace views {
 
         static std::string old_resource;
 
-        if ( old_resource != file->get_name() ) {
-            if ( const auto file_content = package->extract_file( file ) ) {
-                const std::string file_content_str( file_content->begin(), file_content->end() );
+        if ( old_resource != file.get_name() ) {
+            if ( const auto file_content = package->extract_cached( file ) ) {
+                const std::string file_content_str( ( *file_content )->begin(), ( *file_content )->end() );
                 editor->SetText( file_content_str );
                 editor->SetCursorPosition( {} );
 
-                if ( const auto ext = std::filesystem::path( file->get_name() ).extension().string(); ext_map.contains( ext ) ) {
+                if ( const auto ext = std::filesystem::path( file.get_name() ).extension().string(); ext_map.contains( ext ) ) {
                     editor->SetColorizerEnable( true );
                     editor->SetLanguageDefinition( ext_map[ ext ] );
                 }
@@ -33,7 +33,7 @@ namespace views {
                     editor->SetColorizerEnable( false );
                 }
 
-                old_resource = file->get_name();
+                old_resource = file.get_name();
             }
         }
 
@@ -5,6 +5,6 @@
 namespace views {
     class text_content_processor : public content_processor {
     public:
-        void process( const std::shared_ptr< kspkg::package >& package, const std::shared_ptr< kspkg::file >& file ) override;
+        void process( const std::shared_ptr< kspkg::package >& package, const kspkg::file& file ) override;
     };
 } // namespace views
\ No newline at end of file
@@ -20,7 +20,8 @@ namespace views {
         // const auto content_path = R"(D:\SteamLibrary\steamapps\common\Assetto Corsa EVO\content.kspkg)";
         const auto content_path = std::filesystem::current_path() / ".." / "content.kspkg";
 
-        const auto package = kspkg::load_package( content_path );
+        // The sidecar lets later launches skip the metadata parse, it is rebuilt whenever the package changes
+        const auto package = kspkg::load_package( content_path, { .sidecar_index = true } );
 
         if ( !package ) {
             MessageBoxA( nullptr, package.error().c_str(), "Error", MB_ICONERROR );
@@ -114,8 +115,7 @@ namespace views {
                         }
                     }
                     else {
-                        size_t extracted = 0;
-                        size_t errors = 0;
+                        std::vector< kspkg::file > files;
 
                         std::queue< std::shared_ptr< file_node_t > > queue;
                         queue.push( selected_node );
@@ -123,14 +123,7 @@ namespace views {
                         for ( ; !queue.empty(); queue.pop() ) {
                             const auto& node = queue.front();
                             if ( node->is_file ) {
-                                if ( const auto file = package_->extract_file( node->ref, out_path ); file ) {
-                                    extracted += 1;
-                                }
-                                else {
-                                    ImGui::InsertNotification( ImGuiToast( ImGuiToastType::Error, 10000, "Failed to extract file %s: %s",
-                                                                           node->ref->get_name().data(), file.error().c_str() ) );
-                                    errors += 1;
-                                }
+                                files.push_back( node->ref );
                             }
                             else {
                                 for ( const auto& [ _, node ] : node->children ) {
@@ -139,8 +132,19 @@ namespace views {
                             }
                         }
 
+                        const auto report = package_->extract_many( files, out_path );
+
+                        for ( const auto& result : report.results ) {
+                            if ( !result.status ) {
+                                ImGui::InsertNotification( ImGuiToast( ImGuiToastType::Error, 10000, "Failed to extract file %s: %s",
+                                                                       std::string( result.entry.get_name() ).c_str(),
+                                                                       result.status.error().c_str() ) );
+                            }
+                        }
+
                         ImGui::InsertNotification( ImGuiToast( ImGuiToastType::Info, 3000,
-                                                               "Extracted %d file(s), failed to extract %d file(s)", extracted, errors ) );
+                                                               "Extracted %zu file(s), failed to extract %zu file(s)", report.extracted,
+                                                               report.failed ) );
                     }
                 }
 
@@ -199,16 +203,15 @@ namespace views {
         }
     }
 
-    void main_view::build_hierarchy( const std::vector< std::shared_ptr< kspkg::file > >& files,
-                                     const std::shared_ptr< file_node_t >& root ) {
-        for ( const auto& file : files ) {
-            if ( file->is_directory() )
+    void main_view::build_hierarchy( const kspkg::file_table& files, const std::shared_ptr< file_node_t >& root ) {
+        for ( const auto file : files ) {
+            if ( file.is_directory() )
                 continue;
 
             auto current_node = root;
             size_t start = 0, end;
 
-            const std::string path = file->get_name().data();
+            const std::string path( file.get_name() );
             while ( ( end = path.find_first_of( "/\\", start ) ) != std::string::npos ) {
                 if ( auto folder_name = path.substr( start, end - start ); !folder_name.empty() ) {
                     if ( !current_node->children.contains( folder_name ) ) {
@@ -0,0 +1,98 @@
+#include <kspkg-core/cipher.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace {
+
+    using kspkg::detail::cipher_isa_t;
+
+    constexpr size_t kGuard = 64;          // Untouched bytes around every span, catches kernels writing past either end
+    constexpr size_t kMaxShortLength = 320; // Every length mod 64, five times over
+    constexpr size_t kMaxMisalignment = 64;
+
+    const char* isa_name( cipher_isa_t isa ) {
+        switch ( isa ) {
+            case cipher_isa_t::kScalar:
+                return "scalar";
+            case cipher_isa_t::kSse2:
+                return "sse2";
+            case cipher_isa_t::kAvx2:
+                return "avx2";
+            case cipher_isa_t::kAvx512:
+                return "avx512";
+        }
+        return "unknown";
+    }
+
+    /**
+     * @brief Byte-by-byte definition of the cipher, the scalar kernel is checked against it too
+     */
+    void reference_xor( std::span< uint8_t > data, size_t key ) {
+        for ( size_t i = 0; i < data.size(); i++ ) {
+            data[ i ] ^= static_cast< uint8_t >( key >> ( ( i % sizeof( key ) ) * 8 ) );
+        }
+    }
+
+    /**
+     * @brief XOR the same random span with the kernel and the reference and compare the whole buffer, guards included
+     */
+    bool check( cipher_isa_t isa, size_t length, size_t misalignment, size_t key, std::mt19937_64& random ) {
+        std::vector< uint8_t > input( kGuard + misalignment + length + kGuard );
+        std::ranges::generate( input, [ & ] { return static_cast< uint8_t >( random() ); } );
+
+        auto actual = input;
+        auto expected = input;
+        kspkg::detail::encrypt_decrypt_data( std::span( actual ).subspan( kGuard + misalignment, length ), key, isa );
+        reference_xor( std::span( expected ).subspan( kGuard + misalignment, length ), key );
+
+        if ( actual != expected ) {
+            std::fprintf( stderr, "%s: mismatch at length %zu, misalignment %zu, key %016llx\n", isa_name( isa ), length, misalignment,
+                          static_cast< unsigned long long >( key ) );
+            return false;
+        }
+
+        return true;
+    }
+
+} // namespace
+
+int main() {
+    std::mt19937_64 random( 1 );
+    size_t failures = 0;
+
+    for ( const auto isa : { cipher_isa_t::kScalar, cipher_isa_t::kSse2, cipher_isa_t::kAvx2, cipher_isa_t::kAvx512 } ) {
+        if ( !kspkg::detail::is_cipher_isa_supported( isa ) ) {
+            std::printf( "%s: not supported here, skipped\n", isa_name( isa ) );
+            continue;
+        }
+
+        size_t cases = 0;
+
+        // Every key phase, since callers pass `key_at_offset` for data that starts inside an entry
+        for ( size_t phase = 0; phase < sizeof( kspkg::kXorKey ); phase++ ) {
+            const size_t key = kspkg::detail::key_at_offset( kspkg::kXorKey, phase );
+
+            for ( size_t length = 0; length <= kMaxShortLength; length++ ) {
+                for ( size_t misalignment = 0; misalignment < kMaxMisalignment; misalignment++ ) {
+                    failures += check( isa, length, misalignment, key, random ) ? 0 : 1;
+                    cases++;
+                }
+            }
+
+            // Long spans run the unrolled loops for many iterations before the tail
+            for ( size_t length = 0x10000 - 64; length <= 0x10000 + 64; length++ ) {
+                failures += check( isa, length, length % kMaxMisalignment, key, random ) ? 0 : 1;
+                cases++;
+            }
+        }
+
+        std::printf( "%s: %zu cases\n", isa_name( isa ), cases );
+    }
+
+    std::printf( "%zu failure(s)\n", failures );
+    return failures == 0 ? 0 : 1;
+}
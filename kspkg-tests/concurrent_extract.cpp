@@ -0,0 +1,202 @@
+#include <kspkg-core/include.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    constexpr size_t kRounds = 4; // Passes over the whole package per thread
+
+    /**
+     * @brief Extract every entry of one shared package from many threads and compare every byte with what the generator wrote
+     */
+    size_t hammer( const std::filesystem::path& package_path, const kspkg::generator_options_t& generator,
+                   const std::vector< kspkg::generated_entry_t >& entries, bool memory_map, size_t thread_count ) {
+        const auto package = kspkg::load_package( package_path, { .memory_map = memory_map } );
+        if ( !package ) {
+            std::fprintf( stderr, "load failed: %s\n", package.error().c_str() );
+            return 1;
+        }
+
+        std::unordered_map< std::string, size_t > generated_index;
+        for ( size_t i = 0; i < entries.size(); i++ ) {
+            generated_index.emplace( entries[ i ].name, i );
+        }
+
+        const auto& files = ( *package )->get_files();
+        std::atomic< size_t > failures = 0;
+        std::atomic< size_t > checked_bytes = 0;
+
+        {
+            std::vector< std::jthread > threads;
+            for ( size_t t = 0; t < thread_count; t++ ) {
+                threads.emplace_back( [ &, t ] {
+                    // Every thread walks the entries in its own order, so reads of neighbouring entries interleave
+                    std::vector< size_t > order( files.size() );
+                    std::iota( order.begin(), order.end(), size_t { 0 } );
+                    std::mt19937_64 random( t + 1 );
+
+                    for ( size_t round = 0; round < kRounds; round++ ) {
+                        std::ranges::shuffle( order, random );
+
+                        for ( const auto position : order ) {
+                            const auto file = files[ position ];
+                            const auto it = generated_index.find( std::string( file.get_name() ) );
+                            if ( it == generated_index.end() ) {
+                                failures++;
+                                continue;
+                            }
+
+                            const auto expected = kspkg::generated_entry_content( generator, it->second, file.get_file_size() );
+
+                            // Whole entries and random ranges go through different read paths
+                            if ( round % 2 == 0 ) {
+                                const auto contents = ( *package )->extract_file( file );
+                                if ( !contents || *contents != expected )
+                                    failures++;
+                            }
+                            else {
+                                const uint64_t offset = file.get_file_size() ? random() % file.get_file_size() : 0;
+                                std::vector< uint8_t > range( static_cast< size_t >( file.get_file_size() - offset ) );
+
+                                const auto read = ( *package )->read_range( file, offset, range );
+                                if ( !read || *read != range.size() ||
+                                     !std::equal( range.begin(), range.end(), expected.begin() + static_cast< std::ptrdiff_t >( offset ) ) )
+                                    failures++;
+                            }
+
+                            checked_bytes += file.get_file_size();
+                        }
+                    }
+                } );
+            }
+        }
+
+        std::printf( "%s: %zu threads, %zu entries, %llu bytes checked, %zu failure(s)\n", memory_map ? "mmap" : "stream", thread_count,
+                     files.size(), static_cast< unsigned long long >( checked_bytes.load() ), failures.load() );
+        return failures;
+    }
+
+    std::vector< uint8_t > read_bytes( const std::filesystem::path& path ) {
+        std::ifstream input( path, std::ios::binary );
+        return { std::istreambuf_iterator< char >( input ), std::istreambuf_iterator< char >() };
+    }
+
+    /**
+     * @brief Run two `extract_many` batches on one shared package at once and compare every output file with `extract_file`
+     *
+     * Batches spread their runs over the work-stealing pool, entries of at least `kPipelineThreshold` go through the pipeline
+     * on positional reads.
+     */
+    size_t batch( const std::filesystem::path& package_path, const std::filesystem::path& work_dir, bool memory_map, size_t thread_count ) {
+        const auto package = kspkg::load_package( package_path, { .memory_map = memory_map } );
+        if ( !package ) {
+            std::fprintf( stderr, "load failed: %s\n", package.error().c_str() );
+            return 1;
+        }
+
+        const auto& files = ( *package )->get_files();
+        const std::vector< kspkg::file > entries( files.begin(), files.end() );
+        const std::array< std::filesystem::path, 2 > out_directories { work_dir / "batch_a", work_dir / "batch_b" };
+
+        std::array< kspkg::extract_report_t, 2 > reports;
+        {
+            std::vector< std::jthread > batches;
+            for ( size_t b = 0; b < reports.size(); b++ ) {
+                batches.emplace_back( [ &, b ] {
+                    reports[ b ] = ( *package )->extract_many( entries, out_directories[ b ], { .concurrency = thread_count } );
+                } );
+            }
+        }
+
+        size_t failures = 0;
+        for ( const auto& report : reports ) {
+            failures += report.failed + ( report.extracted == entries.size() ? 0 : 1 );
+        }
+
+        uint64_t checked_bytes = 0;
+        for ( const auto& entry : entries ) {
+            const auto expected = ( *package )->extract_file( entry );
+            if ( !expected ) {
+                failures++;
+                continue;
+            }
+
+            std::string relative( entry.get_name() );
+            std::ranges::replace( relative, '\\', '/' );
+
+            for ( const auto& out_directory : out_directories ) {
+                if ( read_bytes( out_directory / relative ) != *expected )
+                    failures++;
+            }
+            checked_bytes += entry.get_file_size();
+        }
+
+        std::error_code ec;
+        for ( const auto& out_directory : out_directories ) {
+            std::filesystem::remove_all( out_directory, ec );
+        }
+
+        std::printf( "%s batches: 2 x %zu threads, %zu entries, %llu bytes checked per batch, %zu failure(s)\n",
+                     memory_map ? "mmap" : "stream", thread_count, entries.size(), static_cast< unsigned long long >( checked_bytes ),
+                     failures );
+        return failures;
+    }
+
+} // namespace
+
+int main() {
+    const auto work_dir = std::filesystem::temp_directory_path() / "kspkg-tests";
+    const auto package_path = work_dir / "concurrent_extract.kspkg";
+    std::filesystem::create_directories( work_dir );
+
+    const kspkg::generator_options_t generator { .entry_count = 2000, .max_file_size = 0x20000, .seed = 7 };
+    const auto entries = kspkg::generate_package( package_path, generator );
+    if ( !entries ) {
+        std::fprintf( stderr, "generate failed: %s\n", entries.error().c_str() );
+        return 1;
+    }
+
+    const size_t thread_count = std::max( 8u, std::thread::hardware_concurrency() );
+
+    size_t failures = 0;
+    for ( const bool memory_map : { false, true } ) {
+        failures += hammer( package_path, generator, *entries, memory_map, thread_count );
+    }
+
+    std::error_code ec;
+    std::filesystem::remove( package_path, ec );
+
+    // Few entries but two of them above `kPipelineThreshold`, one stored encrypted and one plain
+    const auto large_path = work_dir / "concurrent_extract_large.kspkg";
+    const kspkg::generator_options_t large_generator { .entry_count = 64, .min_file_size = 16, .max_file_size = 0x2800000, .seed = 23 };
+    const auto large_entries = kspkg::generate_package( large_path, large_generator );
+    if ( !large_entries ) {
+        std::fprintf( stderr, "generate failed: %s\n", large_entries.error().c_str() );
+        return 1;
+    }
+
+    if ( std::ranges::count_if( *large_entries, []( const auto& entry ) { return entry.file_size > 0x2000000; } ) == 0 ) {
+        std::fprintf( stderr, "the generated package has no entry above 32 MB\n" );
+        failures++;
+    }
+
+    for ( const bool memory_map : { false, true } ) {
+        failures += batch( large_path, work_dir, memory_map, thread_count );
+    }
+
+    std::filesystem::remove( large_path, ec );
+    std::filesystem::remove( work_dir, ec );
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,564 @@
+#include <kspkg-core/include.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    using contents_t = std::map< std::string, std::vector< uint8_t > >; // Entry name to its decrypted contents
+
+    size_t failures = 0;
+
+    void check( bool condition, const char* what ) {
+        if ( !condition ) {
+            std::fprintf( stderr, "FAILED: %s\n", what );
+            failures++;
+        }
+    }
+
+    std::vector< uint8_t > read_bytes( const std::filesystem::path& path ) {
+        std::ifstream input( path, std::ios::binary );
+        return { std::istreambuf_iterator< char >( input ), std::istreambuf_iterator< char >() };
+    }
+
+    void write_bytes( const std::filesystem::path& path, const std::vector< uint8_t >& bytes ) {
+        std::filesystem::create_directories( path.parent_path() );
+        std::ofstream output( path, std::ios::binary | std::ios::trunc );
+        output.write( reinterpret_cast< const char* >( bytes.data() ), static_cast< std::streamsize >( bytes.size() ) );
+    }
+
+    std::vector< uint8_t > random_bytes( size_t size, uint64_t seed ) {
+        std::mt19937_64 random( seed );
+        std::vector< uint8_t > bytes( size );
+        std::ranges::generate( bytes, [ & ] { return static_cast< uint8_t >( random() ); } );
+        return bytes;
+    }
+
+    /**
+     * @brief Freshly generated package in its own directory, with the contents every entry was generated with
+     */
+    struct fixture_t {
+        std::filesystem::path directory;
+        std::filesystem::path package;
+        kspkg::generator_options_t generator;
+        std::vector< kspkg::generated_entry_t > entries;
+        std::vector< uint8_t > original; // Package bytes right after generation
+        contents_t contents;
+
+        explicit fixture_t( const std::string& name )
+            : directory( std::filesystem::temp_directory_path() / "kspkg-tests" / ( "patch_roundtrip_" + name ) ),
+              package( directory / "package.kspkg" ),
+              generator { .entry_count = 200, .min_file_size = 16, .max_file_size = 0x4000, .seed = 11 } {
+            std::error_code ec;
+            std::filesystem::remove_all( directory, ec );
+            std::filesystem::create_directories( directory );
+
+            if ( auto generated = kspkg::generate_package( package, generator ); generated ) {
+                entries = std::move( *generated );
+            }
+            check( !entries.empty(), "generate the package" );
+
+            original = read_bytes( package );
+            for ( size_t i = 0; i < entries.size(); i++ ) {
+                contents[ entries[ i ].name ] = kspkg::generated_entry_content( generator, i, entries[ i ].file_size );
+            }
+        }
+
+        ~fixture_t() {
+            std::error_code ec;
+            std::filesystem::remove_all( directory, ec );
+        }
+
+        [[nodiscard]] std::shared_ptr< kspkg::package > load() const {
+            auto loaded = kspkg::load_package( package );
+            check( loaded.has_value(), "load the package" );
+            return loaded ? *loaded : nullptr;
+        }
+
+        [[nodiscard]] uint64_t size() const {
+            return std::filesystem::file_size( package );
+        }
+
+        /**
+         * @brief Write new contents for the entry into a source file named like the entry, under its own directory
+         */
+        std::filesystem::path write_source( const std::string& name, const std::vector< uint8_t >& bytes, const std::string& tag ) const {
+            const auto separator = name.find_last_of( "\\/" );
+            const auto path = directory / "sources" / tag / name.substr( separator == std::string::npos ? 0 : separator + 1 );
+            write_bytes( path, bytes );
+            return path;
+        }
+
+        /**
+         * @brief Replace entries with a `patch_builder` commit and record the new contents
+         */
+        bool patch( const std::vector< std::pair< std::string, std::vector< uint8_t > > >& changes, const std::string& tag,
+                    const kspkg::patch_options_t& options = {} ) {
+            const auto loaded = load();
+            if ( !loaded )
+                return false;
+
+            kspkg::patch_builder builder( loaded );
+            for ( const auto& [ name, bytes ] : changes ) {
+                check( builder.stage( loaded->find( name ), write_source( name, bytes, tag ) ), "stage an entry" );
+            }
+
+            if ( const auto result = builder.commit( options ); !result ) {
+                std::fprintf( stderr, "commit failed: %s\n", result.error().c_str() );
+                return false;
+            }
+
+            for ( const auto& [ name, bytes ] : changes ) {
+                contents[ name ] = bytes;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Every entry of the package on disk reads back as recorded in `contents`
+         */
+        [[nodiscard]] bool matches() const {
+            const auto loaded = load();
+            if ( !loaded || loaded->get_files().size() != contents.size() )
+                return false;
+
+            for ( const auto file : loaded->get_files() ) {
+                const auto it = contents.find( std::string( file.get_name() ) );
+                const auto extracted = loaded->extract_file( file );
+                if ( it == contents.end() || !extracted || *extracted != it->second )
+                    return false;
+            }
+
+            return true;
+        }
+
+        [[nodiscard]] const std::string& name( size_t index ) const {
+            return entries[ index ].name;
+        }
+    };
+
+    /**
+     * @brief Files from several virtual roots go into one patch with a single metadata block, and removing it restores the package
+     */
+    void batched_commit() {
+        fixture_t fixture( "batched" );
+
+        // Entries from different directories, staged through their virtual roots in one builder
+        std::map< std::string, std::vector< std::filesystem::path > > roots;
+        std::vector< std::pair< std::string, std::vector< uint8_t > > > changes;
+        for ( size_t i = 0; i < fixture.entries.size() && changes.size() < 8; i += 23 ) {
+            const auto& name = fixture.name( i );
+            const auto separator = name.find_last_of( '\\' );
+            const auto bytes = random_bytes( 100 + i * 37, i );
+
+            roots[ separator == std::string::npos ? std::string() : name.substr( 0, separator ) ].push_back(
+                fixture.write_source( name, bytes, "batched" ) );
+            changes.emplace_back( name, bytes );
+        }
+        check( roots.size() > 1, "changes span several virtual roots" );
+
+        const auto loaded = fixture.load();
+        kspkg::patch_builder builder( loaded );
+
+        // A path matching no entry is skipped
+        roots.begin()->second.push_back( fixture.write_source( "no_such_entry.bin", { 1, 2, 3 }, "batched" ) );
+
+        size_t staged = 0;
+        uint64_t staged_bytes = 0;
+        for ( const auto& [ root, paths ] : roots ) {
+            staged += builder.stage( paths, root );
+        }
+        for ( const auto& [ name, bytes ] : changes ) {
+            staged_bytes += bytes.size();
+        }
+
+        check( staged == changes.size() && builder.staged_count() == changes.size(), "every matching file is staged once" );
+        check( builder.staged_bytes() == staged_bytes, "staged bytes cover the staged files" );
+
+        const uint64_t size_before = fixture.size();
+        check( builder.commit().has_value(), "commit the batch" );
+        check( builder.staged_count() == 0, "commit empties the builder" );
+
+        // Marker, data, footer and exactly one metadata block
+        check( fixture.size() == size_before + 5 + staged_bytes + 40 + kspkg::kMetadataSize, "one metadata block per commit" );
+
+        for ( const auto& [ name, bytes ] : changes ) {
+            fixture.contents[ name ] = bytes;
+            const auto extracted = loaded->extract_file( loaded->find( name ) );
+            check( extracted && *extracted == bytes, "the committed package reads the new data" );
+        }
+        check( fixture.matches(), "the reloaded package reads the new data" );
+
+        const auto removed = kspkg::remove_patches( fixture.load() );
+        check( removed && *removed, "remove the patch" );
+        check( read_bytes( fixture.package ) == fixture.original, "removing the patch restores the package" );
+
+        const auto again = kspkg::remove_patches( fixture.load() );
+        check( again && !*again, "nothing is left to remove" );
+    }
+
+    /**
+     * @brief Replacements that fit the data of the newest patch overwrite it, everything older is only ever appended to
+     */
+    void in_place_commit() {
+        fixture_t fixture( "in_place" );
+        const auto& first = fixture.name( 3 );
+        const auto& second = fixture.name( 40 );
+        const auto& base_entry = fixture.name( 90 );
+        auto sidecar = fixture.package;
+        sidecar += ".idx";
+
+        check( fixture.patch( { { first, random_bytes( 3000, 1 ) }, { second, random_bytes( 2000, 2 ) } }, "appended" ),
+               "append a patch" );
+        const auto patched = read_bytes( fixture.package );
+
+        // Load through the sidecar, so there is one to invalidate
+        check( kspkg::load_package( fixture.package, { .sidecar_index = true } ).has_value(), "load through the sidecar" );
+        check( std::filesystem::exists( sidecar ), "the sidecar is written" );
+
+        const uint64_t size_before = fixture.size();
+        check( fixture.patch( { { first, random_bytes( 2500, 3 ) }, { second, random_bytes( 2000, 4 ) } }, "in_place" ),
+               "overwrite the newest patch in place" );
+        check( fixture.size() == size_before, "an in-place update keeps the package size" );
+        check( !std::filesystem::exists( sidecar ), "an in-place update drops the sidecar" );
+        check( fixture.matches(), "the package reads the data written in place" );
+
+        // The generated data is what removing the patch restores, it is never overwritten
+        check( fixture.patch( { { base_entry, random_bytes( 10, 5 ) } }, "base" ), "replace an entry of the base package" );
+        check( fixture.size() > size_before, "a base entry is appended" );
+        check( fixture.matches(), "the package reads the appended data" );
+
+        // A source that shrinks after staging neither qualifies for the in-place update nor can be appended
+        const auto before_failure = read_bytes( fixture.package );
+        {
+            const auto loaded = fixture.load();
+            kspkg::patch_builder builder( loaded );
+            const auto source = fixture.write_source( base_entry, random_bytes( 8, 6 ), "changed" );
+            check( builder.stage( loaded->find( base_entry ), source ), "stage the source" );
+
+            write_bytes( source, random_bytes( 4, 7 ) );
+            check( !builder.commit(), "a source that changed fails the commit" );
+        }
+        check( read_bytes( fixture.package ) == before_failure, "a failed commit leaves the package untouched" );
+        check( fixture.matches(), "a failed commit keeps the entries" );
+
+        check( kspkg::roll_back_patches( fixture.load(), 1 ).has_value(), "roll back to the first patch" );
+        check( fixture.size() == patched.size(), "the rollback ends where the first patch ended" );
+        check( kspkg::roll_back_patches( fixture.load(), 0 ).has_value(), "roll back to the base package" );
+        check( read_bytes( fixture.package ) == fixture.original, "in-place updates never touch the base package" );
+    }
+
+    // Footer layout: magic, patch offset, previous footer, creation time and checksum, right in front of the metadata block
+    constexpr uint64_t kFooterSize = 40;
+    constexpr uint64_t kFooterPatchOffset = 8;
+    constexpr uint64_t kFooterPrevious = 16;
+    constexpr uint64_t kFooterCreated = 24;
+    constexpr uint64_t kFooterChecksum = 32;
+
+    uint64_t read_u64( const std::vector< uint8_t >& bytes, uint64_t position ) {
+        uint64_t value;
+        std::memcpy( &value, bytes.data() + position, sizeof( value ) );
+        return value;
+    }
+
+    void write_u64( std::vector< uint8_t >& bytes, uint64_t position, uint64_t value ) {
+        std::memcpy( bytes.data() + position, &value, sizeof( value ) );
+    }
+
+    /**
+     * @brief Footers chain every patch to the previous one, and a footer that does not verify is never trusted
+     */
+    void footer_chain() {
+        fixture_t fixture( "footers" );
+        const uint64_t base_size = fixture.size();
+
+        check( fixture.patch( { { fixture.name( 5 ), random_bytes( 700, 1 ) } }, "first" ), "append the first patch" );
+        const auto first_patch = read_bytes( fixture.package );
+        check( fixture.patch( { { fixture.name( 6 ), random_bytes( 900, 2 ) } }, "second" ), "append the second patch" );
+
+        auto bytes = read_bytes( fixture.package );
+        const uint64_t footer = bytes.size() - kspkg::kMetadataSize - kFooterSize;
+        check( read_u64( bytes, footer + kFooterPatchOffset ) == first_patch.size(), "the footer points at its marker" );
+        check( read_u64( bytes, footer + kFooterPrevious ) == first_patch.size() - kspkg::kMetadataSize - kFooterSize,
+               "the footer points at the previous footer" );
+
+        const auto generations = kspkg::list_patches( fixture.load(), false );
+        check( generations && generations->size() == 3 && ( *generations )[ 1 ].offset == base_size &&
+                   ( *generations )[ 2 ].offset == first_patch.size(),
+               "the chain lists every generation" );
+
+        // A footer pointing somewhere else than where it was sealed for, here at the first patch, is rejected. The marker of
+        // the second patch is still found by scanning, so only that patch is removed
+        auto moved = bytes;
+        write_u64( moved, footer + kFooterPatchOffset, base_size );
+        write_bytes( fixture.package, moved );
+
+        const auto listed = kspkg::list_patches( fixture.load(), false );
+        check( listed && listed->size() == 1, "a footer that does not verify ends the chain" );
+
+        const auto removed = kspkg::remove_patches( fixture.load() );
+        check( removed && *removed, "remove the patch with the rejected footer" );
+        check( read_bytes( fixture.package ) == first_patch, "only the newest patch is removed" );
+
+        // Same for a damaged checksum
+        write_u64( bytes, footer + kFooterChecksum, read_u64( bytes, footer + kFooterChecksum ) ^ 1 );
+        write_bytes( fixture.package, bytes );
+
+        const auto damaged = kspkg::list_patches( fixture.load(), false );
+        check( damaged && damaged->size() == 1, "a damaged checksum ends the chain" );
+        check( kspkg::remove_patches( fixture.load() ).value_or( false ), "remove the patch with the damaged checksum" );
+        check( read_bytes( fixture.package ) == first_patch, "the damaged footer does not move the cut" );
+    }
+
+    /**
+     * @brief Patches written before footers existed are found by their marker, marker bytes inside data are not
+     */
+    void legacy_markers() {
+        fixture_t fixture( "legacy" );
+
+        // Entry data can hold the marker bytes, in front of the real marker they must not count as a patch start
+        const std::string marker = "12345";
+        auto payload = random_bytes( 1000, 1 );
+        payload.insert( payload.end(), marker.begin(), marker.end() );
+        const auto trailer = random_bytes( 100, 2 );
+        payload.insert( payload.end(), trailer.begin(), trailer.end() );
+
+        // Validation reads the metadata block in front of the marker, here one that leaves its first slot empty. Slots may be
+        // free anywhere, so the base package is rewritten with every descriptor moved up by one slot
+        const uint64_t base_data = fixture.original.size() - kspkg::kMetadataSize;
+        std::vector< uint8_t > block( fixture.original.begin() + static_cast< std::ptrdiff_t >( base_data ), fixture.original.end() );
+        kspkg::detail::encrypt_decrypt_data( block, kspkg::kXorKey );
+        std::copy_backward( block.begin(), block.end() - sizeof( kspkg::file_desc_t ), block.end() );
+        std::fill_n( block.begin(), sizeof( kspkg::file_desc_t ), uint8_t { 0 } );
+        kspkg::detail::encrypt_decrypt_data( block, kspkg::kXorKey );
+        std::ranges::copy( block, fixture.original.begin() + static_cast< std::ptrdiff_t >( base_data ) );
+
+        // The old patch is its marker, the data and a full metadata block, without a footer
+        auto bytes = fixture.original;
+        bytes.insert( bytes.end(), marker.begin(), marker.end() );
+        bytes.insert( bytes.end(), payload.begin(), payload.end() );
+        bytes.insert( bytes.end(), block.begin(), block.end() );
+        write_bytes( fixture.package, bytes );
+
+        check( fixture.matches(), "the legacy patch loads" );
+
+        const auto removed = kspkg::remove_patches( fixture.load() );
+        check( removed && *removed, "find the legacy patch" );
+        check( read_bytes( fixture.package ) == fixture.original, "cut at the real marker" );
+
+        const auto again = kspkg::remove_patches( fixture.load() );
+        check( again && !*again, "the base package has no patch" );
+        check( read_bytes( fixture.package ) == fixture.original, "a package without patches is left alone" );
+    }
+
+    /**
+     * @brief Generations list what each patch touched, and rolling back to one restores exactly the package it ended in
+     */
+    void patch_stack() {
+        fixture_t fixture( "stack" );
+        const auto& first = fixture.name( 10 );
+        const auto& second = fixture.name( 20 );
+        const auto& third = fixture.name( 30 );
+
+        std::vector< uint64_t > ends { fixture.size() };
+        std::vector< contents_t > states { fixture.contents };
+        const std::vector< std::vector< std::pair< std::string, std::vector< uint8_t > > > > patches {
+            { { first, random_bytes( 500, 1 ) }, { second, random_bytes( 600, 2 ) } },
+            { { third, random_bytes( 700, 3 ) } },
+            { { first, random_bytes( 800, 4 ) } },
+        };
+
+        for ( size_t i = 0; i < patches.size(); i++ ) {
+            check( fixture.patch( patches[ i ], "generation_" + std::to_string( i + 1 ) ), "append a generation" );
+            ends.push_back( fixture.size() );
+            states.push_back( fixture.contents );
+        }
+
+        const auto generations = kspkg::list_patches( fixture.load() );
+        check( generations && generations->size() == 4, "list every generation" );
+        if ( generations && generations->size() == 4 ) {
+            for ( size_t i = 0; i < generations->size(); i++ ) {
+                const auto& generation = ( *generations )[ i ];
+                check( generation.offset == ( i == 0 ? 0 : ends[ i - 1 ] ) && generation.offset + generation.size == ends[ i ],
+                       "generations cover the package back to back" );
+                check( ( generation.created != 0 ) == ( i != 0 ), "only patches carry a creation time" );
+
+                std::vector< std::string > touched;
+                if ( i != 0 ) {
+                    for ( const auto& [ name, bytes ] : patches[ i - 1 ] ) {
+                        touched.push_back( name );
+                    }
+                }
+                auto listed = generation.touched;
+                std::ranges::sort( touched );
+                std::ranges::sort( listed );
+                check( listed == touched, "a generation lists the entries it touched" );
+            }
+        }
+
+        const auto before = read_bytes( fixture.package );
+        check( !kspkg::roll_back_patches( fixture.load(), 4 ), "a generation that does not exist is refused" );
+        check( kspkg::roll_back_patches( fixture.load(), 3 ).has_value(), "rolling back to the newest generation succeeds" );
+        check( read_bytes( fixture.package ) == before, "rolling back to the newest generation changes nothing" );
+
+        check( kspkg::roll_back_patches( fixture.load(), 2 ).has_value(), "roll back one generation" );
+        check( fixture.size() == ends[ 2 ], "the rollback cuts at the generation boundary" );
+        fixture.contents = states[ 2 ];
+        check( fixture.matches(), "the entries are back to the second generation" );
+
+        check( kspkg::roll_back_patches( fixture.load(), 0 ).has_value(), "roll back to the base package" );
+        check( read_bytes( fixture.package ) == fixture.original, "generation 0 is the generated package" );
+    }
+
+    /**
+     * @brief Directory prefixes of every entry, each of them names a subtree
+     */
+    std::vector< std::string > subtrees( const kspkg::file_table& files ) {
+        std::vector< std::string > prefixes;
+        for ( const auto file : files ) {
+            const std::string name( file.get_name() );
+            for ( auto separator = name.find( '\\' ); separator != std::string::npos; separator = name.find( '\\', separator + 1 ) ) {
+                prefixes.push_back( name.substr( 0, separator + 1 ) );
+            }
+        }
+
+        std::ranges::sort( prefixes );
+        prefixes.erase( std::unique( prefixes.begin(), prefixes.end() ), prefixes.end() );
+        return prefixes;
+    }
+
+    /**
+     * @brief Compaction keeps every entry, drops the patches for good and seals the result against `remove_patches`
+     */
+    void compact( kspkg::compact_layout_t layout, const std::string& name ) {
+        fixture_t fixture( name );
+
+        // The second patch supersedes data of the first one, so both patches leave dead data behind
+        check( fixture.patch( { { fixture.name( 1 ), random_bytes( 4000, 1 ) }, { fixture.name( 2 ), random_bytes( 100, 2 ) } }, "first" ),
+               "append the first patch" );
+        check( fixture.patch( { { fixture.name( 1 ), random_bytes( 5000, 3 ) }, { fixture.name( 50 ), random_bytes( 10, 4 ) } }, "second" ),
+               "append the second patch" );
+
+        const uint64_t size_before = fixture.size();
+        const auto report = kspkg::compact_package( fixture.load(), { .layout = layout } );
+        check( report.has_value(), "compact the package" );
+        if ( !report )
+            return;
+
+        check( report->old_size == size_before && report->new_size == fixture.size(), "the report has the sizes" );
+        check( report->new_size < report->old_size && report->reclaimed >= report->old_size - report->new_size, "compaction shrinks the package" );
+
+        // Only the live data, the base footer and one metadata block are left
+        uint64_t live = 0;
+        for ( const auto& [ entry, bytes ] : fixture.contents ) {
+            live += bytes.size();
+        }
+        check( report->new_size == live + kFooterSize + kspkg::kMetadataSize, "no dead data is left" );
+        check( fixture.matches(), "every entry keeps its contents" );
+
+        if ( layout == kspkg::compact_layout_t::kByPath ) {
+            // Every subtree is one contiguous range of data
+            const auto loaded = fixture.load();
+            bool contiguous = true;
+            for ( const auto& prefix : subtrees( loaded->get_files() ) ) {
+                uint64_t begin = UINT64_MAX, end = 0;
+                for ( const auto file : loaded->get_files() ) {
+                    if ( file.get_name().starts_with( prefix ) ) {
+                        begin = std::min< uint64_t >( begin, file.get_file_offset() );
+                        end = std::max< uint64_t >( end, file.get_file_offset() + file.get_file_size() );
+                    }
+                }
+
+                for ( const auto file : loaded->get_files() ) {
+                    if ( !file.get_name().starts_with( prefix ) && file.get_file_size() != 0 && file.get_file_offset() < end &&
+                         file.get_file_offset() + file.get_file_size() > begin )
+                        contiguous = false;
+                }
+            }
+            check( contiguous, "every subtree is one contiguous range" );
+        }
+
+        // The compacted package is a base, there is nothing to remove or list
+        const auto compacted = read_bytes( fixture.package );
+        const auto removed = kspkg::remove_patches( fixture.load() );
+        check( removed && !*removed, "a compacted package has no patch to remove" );
+        check( read_bytes( fixture.package ) == compacted, "remove_patches leaves the compacted package alone" );
+
+        const auto generations = kspkg::list_patches( fixture.load(), false );
+        check( generations && generations->size() == 1, "a compacted package is one generation" );
+
+        // Patches applied afterwards are removed down to the compacted package, not further
+        check( fixture.patch( { { fixture.name( 3 ), random_bytes( 300, 5 ) } }, "after" ), "patch the compacted package" );
+        check( kspkg::remove_patches( fixture.load() ).value_or( false ), "remove the later patch" );
+        check( read_bytes( fixture.package ) == compacted, "removing the later patch restores the compacted package" );
+        check( !kspkg::remove_patches( fixture.load() ).value_or( true ), "the compacted package stays the base" );
+    }
+
+    /**
+     * @brief Package bytes with the creation time and checksum of the footer at `footer` cleared, they depend on the clock
+     */
+    std::vector< uint8_t > without_timestamp( std::vector< uint8_t > bytes, uint64_t footer ) {
+        const auto begin = bytes.begin() + static_cast< std::ptrdiff_t >( footer );
+        std::fill( begin + kFooterCreated, begin + kFooterSize, uint8_t { 0 } );
+        return bytes;
+    }
+
+    /**
+     * @brief Shared metadata tails read back byte for byte like written ones, whether or not the file system can clone
+     */
+    void shared_metadata_tail() {
+        fixture_t written( "written_tail" );
+        fixture_t shared( "shared_tail" );
+        check( written.original == shared.original, "the same seed generates the same package" );
+
+        const std::vector< std::pair< std::string, std::vector< uint8_t > > > changes {
+            { written.name( 7 ), random_bytes( 1200, 1 ) },
+            { written.name( 8 ), random_bytes( 0x3000, 2 ) },
+        };
+
+        check( written.patch( changes, "patch" ), "patch with a written tail" );
+        check( shared.patch( changes, "patch", { .share_metadata_tail = true } ), "patch with a shared tail" );
+
+        const uint64_t footer = written.size() - kspkg::kMetadataSize - kFooterSize;
+        check( shared.size() == written.size(), "a shared tail has the full size" );
+        check( without_timestamp( read_bytes( shared.package ), footer ) == without_timestamp( read_bytes( written.package ), footer ),
+               "a patch with a shared tail matches the written one" );
+        check( shared.matches(), "the patch with a shared tail loads" );
+
+        check( kspkg::compact_package( written.load() ).has_value(), "compact with a written tail" );
+        check( kspkg::compact_package( shared.load(), { .share_metadata_tail = true } ).has_value(), "compact with a shared tail" );
+
+        const uint64_t base_footer = written.size() - kspkg::kMetadataSize - kFooterSize;
+        check( shared.size() == written.size(), "a compacted shared tail has the full size" );
+        check( without_timestamp( read_bytes( shared.package ), base_footer ) ==
+                   without_timestamp( read_bytes( written.package ), base_footer ),
+               "compaction with a shared tail matches the written one" );
+        check( shared.matches(), "the compacted package with a shared tail loads" );
+    }
+
+} // namespace
+
+int main() {
+    batched_commit();
+    in_place_commit();
+    footer_chain();
+    legacy_markers();
+    patch_stack();
+    compact( kspkg::compact_layout_t::kPackageOrder, "compact" );
+    compact( kspkg::compact_layout_t::kByPath, "rebuild" );
+    shared_metadata_tail();
+
+    std::error_code ec;
+    std::filesystem::remove( std::filesystem::temp_directory_path() / "kspkg-tests", ec );
+
+    std::printf( "%zu failure(s)\n", failures );
+    return failures == 0 ? 0 : 1;
+}